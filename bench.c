@@ -0,0 +1,559 @@
+/*  bench : speed and match statistics of mmc.c
+    Copyright (C) Yann Collet 2018-present
+
+    GPL v2 License
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    You can contact the author at :
+    - public issue list : https://github.com/Cyan4973/mmc/issues
+    - website : http://fastcompression.blogspot.com/
+*/
+
+#if defined(__linux__)
+#  define _GNU_SOURCE   /* syscall */
+#  define BENCH_PERF 1  /* hardware counters, through perf_event_open() */
+#else
+#  define BENCH_PERF 0
+#endif
+
+#include <stdlib.h>  /* malloc, free, atoi, exit */
+#include <stdio.h>   /* fopen, fread, fseek, ftell, fclose, printf, fprintf */
+#include <string.h>  /* memcpy, memset, strcmp */
+#include <time.h>    /* clock */
+#include <assert.h>
+#if BENCH_PERF
+#  include <unistd.h>               /* syscall, read, close */
+#  include <sys/syscall.h>          /* __NR_perf_event_open */
+#  include <sys/ioctl.h>            /* ioctl */
+#  include <linux/perf_event.h>     /* perf_event_attr */
+#endif
+
+#include "mem.h"   /* U32, U64 */
+#include "mmc.h"
+
+#define KB *(1<<10)
+#define MB *(1<<20)
+
+#define NB_ITERATIONS_DEFAULT 3
+#define SYNTHETIC_SIZE_DEFAULT (1 MB)
+#define STREAM_SIZE (64 KB)   /* size of independent streams, for interleaved search */
+#define MAX_STREAMS 256
+
+#define MIN(a,b) ((a)<(b) ? (a) : (b))
+
+
+/* --- safe variants --- */
+/* errors are checked explicitly, so that they remain detected when asserts are disabled (NDEBUG) */
+static void EXIT_ERROR(const char* msg, const char* name)
+{
+    fprintf(stderr, "error : %s%s%s \n", msg, name[0] ? " " : "", name);
+    exit(1);
+}
+
+static void* MALLOC(size_t s)
+{
+    void* const buf = calloc(1, s);
+    if (buf == NULL) EXIT_ERROR("allocation failed", "");
+    return buf;
+}
+#define FREE free   /* cannot fail */
+
+static FILE* FOPEN(const char* name, const char* mode)
+{
+    FILE* f = fopen(name, mode);
+    if (f == NULL) EXIT_ERROR("cannot open", name);
+    return f;
+}
+
+static size_t FREAD(void* buf, size_t s, size_t n, FILE* f)
+{
+    size_t const read = fread(buf, s, n, f);
+    if (ferror(f)) EXIT_ERROR("read failed", "");
+    assert(read <= s*n);
+    return read;
+}
+
+static void FCLOSE(FILE* f)
+{
+    if (fclose(f) != 0) EXIT_ERROR("close failed", "");
+}
+
+
+/* --- synthetic corpora --- */
+/* all generators are deterministic : same content on every run and platform */
+
+static unsigned BENCH_rand(unsigned* state)
+{
+    *state = *state * 1103515245U + 12345U;
+    return (*state >> 16) & 0x7FFF;
+}
+
+static void genRandom(unsigned char* dst, size_t size)
+{
+    unsigned seed = 1;
+    size_t u;
+    for (u=0; u<size; u++) dst[u] = (unsigned char)BENCH_rand(&seed);
+}
+
+static void genText(unsigned char* dst, size_t size)
+{
+    static const char* const words[] = {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on",
+        "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had", "they",
+        "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if", "more",
+        "when", "will", "would", "who", "so", "no", "match", "chain", "window", "search", "level", "buffer",
+        "compression", "position", "sequence", "algorithm", "morphing", "dictionary", "length", "offset" };
+    size_t const nbWords = sizeof(words) / sizeof(words[0]);
+    unsigned seed = 2;
+    size_t pos = 0, nbWordsInSentence = 0;
+    while (pos < size) {
+        /* skewed distribution : frequent words are picked more often */
+        unsigned const r = BENCH_rand(&seed);
+        const char* const word = words[((r % nbWords) * (r % nbWords)) / nbWords];
+        size_t u;
+        for (u=0; word[u] && pos<size; u++)
+            dst[pos++] = (unsigned char)((nbWordsInSentence==0 && u==0) ? word[u] - 'a' + 'A' : word[u]);
+        nbWordsInSentence++;
+        if (pos < size) {
+            if (nbWordsInSentence > 6 + (r & 7)) {
+                dst[pos++] = '.';
+                nbWordsInSentence = 0;
+                if ((pos < size) && ((r & 0x30) == 0)) dst[pos++] = '\n';
+                else if (pos < size) dst[pos++] = ' ';
+            } else {
+                dst[pos++] = ' ';
+    }   }   }
+}
+
+static void genRLE(unsigned char* dst, size_t size)
+{
+    unsigned seed = 3;
+    size_t pos = 0;
+    while (pos < size) {
+        unsigned const r = BENCH_rand(&seed);
+        unsigned char const c = (unsigned char)(BENCH_rand(&seed) & 0x0F);   /* few distinct values */
+        size_t runLength = (r & 3) ? 1 + (r & 7) : 8 + (r % 500);           /* mostly short runs, some long ones */
+        if (runLength > size - pos) runLength = size - pos;
+        memset(dst + pos, c, runLength);
+        pos += runLength;
+    }
+}
+
+static void genPeriodic(unsigned char* dst, size_t size)
+{
+    size_t const period = 1499;
+    unsigned seed = 4;
+    size_t u;
+    for (u=0; u<size; u++) {
+        dst[u] = (u < period) ? (unsigned char)BENCH_rand(&seed) : dst[u-period];
+        if ((BENCH_rand(&seed) & 0x3FF) == 0) dst[u] ^= 0x55;   /* rare mutations, propagated to later periods */
+    }
+}
+
+static void genRecords(unsigned char* dst, size_t size)
+{
+#define RECORD_SIZE 48
+    static const char* const status[] = { "OK     ", "WARNING", "ERROR  ", "PENDING" };
+    unsigned seed = 5;
+    unsigned id = 100000, timestamp = 1500000000;
+    size_t pos = 0;
+    while (pos < size) {
+        unsigned char record[RECORD_SIZE];
+        unsigned const r = BENCH_rand(&seed);
+        size_t const copySize = (size - pos < RECORD_SIZE) ? size - pos : RECORD_SIZE;
+        memset(record, 0, sizeof(record));
+        memcpy(record, &id, sizeof(id));
+        memcpy(record + 4, &timestamp, sizeof(timestamp));
+        memcpy(record + 8, status[r & 3], 7);
+        record[16] = (unsigned char)(r >> 2);                  /* category */
+        record[17] = (unsigned char)BENCH_rand(&seed);          /* measurement */
+        record[18] = (unsigned char)BENCH_rand(&seed);
+        memcpy(record + 24, "region-eu-west-1", 16);
+        record[40 + (r % 8)] = (unsigned char)BENCH_rand(&seed);
+        memcpy(dst + pos, record, copySize);
+        pos += copySize;
+        id++;
+        timestamp += 1 + (r % 3);
+    }
+}
+
+typedef void (*generator_f)(unsigned char* dst, size_t size);
+typedef struct { const char* name; generator_f generate; } corpus_t;
+
+static const corpus_t syntheticCorpora[] = {
+    { "random",   genRandom },
+    { "text",     genText },
+    { "rle",      genRLE },
+    { "periodic", genPeriodic },
+    { "records",  genRecords },
+};
+
+
+/* --- hardware counters --- */
+/* only the search and insert loops are measured : MMC_init() and result collection are excluded */
+
+typedef enum { perf_cycles=0, perf_instructions, perf_l1Misses, perf_llcMisses, perf_tlbMisses, perf_branchMisses, perf_nbCounters } perfCounter_e;
+static const char* const perfNames[perf_nbCounters] = { "cycles/B", "instr/B", "L1miss/KB", "LLCmiss/KB", "dTLBmiss/KB", "brMiss/KB" };
+
+typedef struct {
+    int fd[perf_nbCounters];                /* -1 when not available */
+    U64 total[perf_nbCounters];
+} perfCounters_t;
+
+static int g_profile = 0;
+static perfCounters_t g_perf;
+static unsigned g_nbStreamsMax = 0;   /* >0 : also benchmark interleaved search of 1, 2, 4, ... up to this nb of streams */
+
+#if BENCH_PERF
+static int PERF_open(U32 type, U64 config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0 /* this process */, -1 /* any cpu */, -1 /* no group */, 0);
+}
+#endif
+
+/* PERF_init() : @return : nb of available counters */
+static int PERF_init(perfCounters_t* perf)
+{
+    int n, nbAvailable = 0;
+    for (n=0; n<perf_nbCounters; n++) perf->fd[n] = -1;
+#if BENCH_PERF
+#   define L1D_READ_MISS (PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+#   define DTLB_READ_MISS (PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+    perf->fd[perf_cycles]       = PERF_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    perf->fd[perf_instructions] = PERF_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fd[perf_l1Misses]     = PERF_open(PERF_TYPE_HW_CACHE, L1D_READ_MISS);
+    perf->fd[perf_llcMisses]    = PERF_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    perf->fd[perf_tlbMisses]    = PERF_open(PERF_TYPE_HW_CACHE, DTLB_READ_MISS);
+    perf->fd[perf_branchMisses] = PERF_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#   undef L1D_READ_MISS
+#   undef DTLB_READ_MISS
+#endif
+    for (n=0; n<perf_nbCounters; n++) nbAvailable += (perf->fd[n] >= 0);
+    return nbAvailable;
+}
+
+static void PERF_reset(perfCounters_t* perf)
+{
+    memset(perf->total, 0, sizeof(perf->total));
+}
+
+static void PERF_start(perfCounters_t* perf)
+{
+#if BENCH_PERF
+    int n;
+    for (n=0; n<perf_nbCounters; n++) {
+        if (perf->fd[n] < 0) continue;
+        ioctl(perf->fd[n], PERF_EVENT_IOC_RESET, 0);
+        ioctl(perf->fd[n], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)perf;
+#endif
+}
+
+static void PERF_stop(perfCounters_t* perf)
+{
+#if BENCH_PERF
+    int n;
+    for (n=0; n<perf_nbCounters; n++) {
+        U64 value;
+        if (perf->fd[n] < 0) continue;
+        ioctl(perf->fd[n], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf->fd[n], &value, sizeof(value)) == (ssize_t)sizeof(value)) perf->total[n] += value;
+    }
+#else
+    (void)perf;
+#endif
+}
+
+static void PERF_free(perfCounters_t* perf)
+{
+#if BENCH_PERF
+    int n;
+    for (n=0; n<perf_nbCounters; n++) if (perf->fd[n] >= 0) close(perf->fd[n]);
+#endif
+    (void)perf;
+}
+
+static void PERF_display(const perfCounters_t* perf, size_t nbBytes)
+{
+    int n;
+    printf("   ");
+    for (n=0; n<perf_nbCounters; n++) {
+        double const scale = (n <= perf_instructions) ? 1. : 1 KB;   /* events per byte, or per KB */
+        if (perf->fd[n] < 0) printf(" %s:n/a", perfNames[n]);
+        else printf(" %s:%.2f", perfNames[n], nbBytes ? (double)perf->total[n] * scale / (double)nbBytes : 0.);
+    }
+    if ((perf->fd[perf_cycles] >= 0) && (perf->fd[perf_instructions] >= 0) && perf->total[perf_cycles])
+        printf(" IPC:%.2f", (double)perf->total[perf_instructions] / (double)perf->total[perf_cycles]);
+    printf(" \n");
+}
+
+
+/* --- benchmark --- */
+
+typedef enum { mode_search=0, mode_greedy=MMC_greedy, mode_lazy=MMC_lazy, mode_lazy2=MMC_lazy2, mode_batch } benchMode_e;
+static const char* const modeNames[] = { "search", "greedy", "lazy", "lazy2", "batch" };
+
+typedef struct {
+    size_t nbMatches;
+    size_t matchedBytes;
+} benchResult_t;
+
+/* search every position, as example.c does */
+static benchResult_t runSearch(MMC_ctx* mmc, const unsigned char* buf, size_t size)
+{
+    benchResult_t result = { 0, 0 };
+    size_t pos;
+    MMC_init(mmc, buf);
+    if (g_profile) PERF_start(&g_perf);
+    for (pos=0; pos<size; pos++) {
+        const void* match;
+        size_t const length = MMC_insertAndFindBestMatch(mmc, buf+pos, size-pos, &match);
+        if (length > 0) { result.nbMatches++; result.matchedBytes += length; }
+    }
+    if (g_profile) PERF_stop(&g_perf);
+    return result;
+}
+
+/* search every position, in a single call */
+static benchResult_t runBatch(MMC_ctx* mmc, const unsigned char* buf, size_t size, unsigned* lengths, unsigned* offsets)
+{
+    benchResult_t result = { 0, 0 };
+    size_t pos;
+    MMC_init(mmc, buf);
+    if (g_profile) PERF_start(&g_perf);
+    result.nbMatches = MMC_findMatchesBatch(mmc, buf, size, lengths, offsets);
+    if (g_profile) PERF_stop(&g_perf);
+    for (pos=0; pos<size; pos++) result.matchedBytes += lengths[pos];
+    return result;
+}
+
+static benchResult_t runParse(MMC_ctx* mmc, const unsigned char* buf, size_t size,
+                              MMC_strategy strategy, MMC_sequence_t* seqs)
+{
+    benchResult_t result = { 0, 0 };
+    size_t nbSeqs, n;
+    MMC_init(mmc, buf);
+    if (g_profile) PERF_start(&g_perf);
+    nbSeqs = MMC_parse(mmc, buf, size, strategy, seqs);
+    if (g_profile) PERF_stop(&g_perf);
+    if (nbSeqs == 0) EXIT_ERROR("MMC_parse() failed", "");
+    for (n=0; n<nbSeqs; n++) {
+        if (seqs[n].matchLength) { result.nbMatches++; result.matchedBytes += seqs[n].matchLength; }
+    }
+    return result;
+}
+
+/* cut buf into independent streams of STREAM_SIZE bytes, each searched from a fresh start,
+ * nbStreams at a time, interleaved : nbStreams==1 is the sequential reference */
+static benchResult_t runInterleaved(MMC_ctx** ctxs, unsigned nbStreams, const unsigned char* buf, size_t size,
+                                    unsigned* lengths, unsigned* offsets)
+{
+    benchResult_t result = { 0, 0 };
+    MMC_stream_t streams[MAX_STREAMS];
+    size_t start, pos;
+    if (g_profile) PERF_start(&g_perf);
+    for (start=0; start<size; start+=(size_t)nbStreams*STREAM_SIZE) {
+        unsigned s;
+        for (s=0; (s<nbStreams) && (start + (size_t)s*STREAM_SIZE < size); s++) {
+            size_t const streamStart = start + (size_t)s*STREAM_SIZE;
+            MMC_init(ctxs[s], buf + streamStart);
+            streams[s].ctx = ctxs[s];
+            streams[s].src = buf + streamStart;
+            streams[s].srcSize = MIN(STREAM_SIZE, size - streamStart);
+            streams[s].lengths = lengths + streamStart;
+            streams[s].offsets = offsets + streamStart;
+        }
+        result.nbMatches += MMC_findMatchesInterleaved(streams, s);
+    }
+    if (g_profile) PERF_stop(&g_perf);
+    for (pos=0; pos<size; pos++) result.matchedBytes += lengths[pos];
+    return result;
+}
+
+static void benchInterleaved(const char* name, const unsigned char* buf, size_t size,
+                             MMC_parameters params, unsigned nbIterations, unsigned* lengths, unsigned* offsets)
+{
+    MMC_ctx* ctxs[MAX_STREAMS];
+    unsigned nbStreams, s;
+    for (s=0; s<g_nbStreamsMax; s++) { ctxs[s] = MMC_createAdvanced(params); if (ctxs[s] == NULL) EXIT_ERROR("cannot create context (invalid parameters)", ""); }
+
+    for (nbStreams=1; nbStreams<=g_nbStreamsMax; nbStreams*=2) {
+        benchResult_t result = { 0, 0 };
+        double bestTime = 0.;
+        char modeName[16];
+        unsigned it;
+        for (it=0; it<=nbIterations; it++) {
+            clock_t start;
+            double time;
+            if (it == 1) PERF_reset(&g_perf);
+            start = clock();
+            result = runInterleaved(ctxs, nbStreams, buf, size, lengths, offsets);
+            time = (double)(clock() - start) / CLOCKS_PER_SEC;
+            if ((it > 0) && ((it == 1) || (time < bestTime))) bestTime = time;
+        }
+        if (bestTime <= 0.) bestTime = 1. / CLOCKS_PER_SEC;
+        sprintf(modeName, "x%u", nbStreams);
+        printf("%-16.16s %-7s %10lu %9.1f %10.1f %9.1f %12lu %7.2f%% \n",
+                name, modeName, (unsigned long)size,
+                (double)size / bestTime / (1 MB),
+                size ? (double)result.nbMatches * (1 KB) / (double)size : 0.,
+                result.nbMatches ? (double)result.matchedBytes / (double)result.nbMatches : 0.,
+                (unsigned long)result.matchedBytes, 0.);
+        if (g_profile) PERF_display(&g_perf, size * nbIterations);
+        fflush(stdout);
+    }
+
+    for (s=0; s<g_nbStreamsMax; s++) MMC_free(ctxs[s]);
+}
+
+static void benchBuffer(const char* name, const unsigned char* buf, size_t size,
+                        MMC_parameters params, unsigned nbIterations)
+{
+    MMC_ctx* const mmc = MMC_createAdvanced(params);
+    MMC_sequence_t* const seqs = (MMC_sequence_t*)MALLOC(MMC_PARSE_BOUND(size) * sizeof(MMC_sequence_t));
+    unsigned* const lengths = (unsigned*)MALLOC(size * sizeof(unsigned) + 1);
+    unsigned* const offsets = (unsigned*)MALLOC(size * sizeof(unsigned) + 1);
+    int mode;
+    if (mmc == NULL) EXIT_ERROR("cannot create context (invalid parameters)", "");
+
+    for (mode=mode_search; mode<=mode_batch; mode++) {
+        int const isParse = (mode != mode_search) && (mode != mode_batch);
+        benchResult_t result = { 0, 0 };
+        double bestTime = 0.;
+        unsigned it;
+        /* first run is a warmup, not measured */
+        for (it=0; it<=nbIterations; it++) {
+            clock_t start;
+            double time;
+            if (it == 1) PERF_reset(&g_perf);
+            start = clock();
+            if (mode == mode_search) result = runSearch(mmc, buf, size);
+            else if (mode == mode_batch) result = runBatch(mmc, buf, size, lengths, offsets);
+            else result = runParse(mmc, buf, size, (MMC_strategy)mode, seqs);
+            time = (double)(clock() - start) / CLOCKS_PER_SEC;
+            if ((it > 0) && ((it == 1) || (time < bestTime))) bestTime = time;
+        }
+        if (bestTime <= 0.) bestTime = 1. / CLOCKS_PER_SEC;
+        printf("%-16.16s %-7s %10lu %9.1f %10.1f %9.1f %12lu %7.2f%% \n",
+                name, modeNames[mode], (unsigned long)size,
+                (double)size / bestTime / (1 MB),
+                size ? (double)result.nbMatches * (1 KB) / (double)size : 0.,
+                result.nbMatches ? (double)result.matchedBytes / (double)result.nbMatches : 0.,
+                (unsigned long)result.matchedBytes,
+                (isParse && size) ? (double)result.matchedBytes * 100. / (double)size : 0.);
+        if (g_profile) PERF_display(&g_perf, size * nbIterations);
+        {   MMC_stats_t stats;   /* only available when mmc.c is compiled with MMC_STATS=1 */
+            if (!MMC_getStats(mmc, &stats))
+                printf("    lookups:%lu hops:%lu collisions:%lu promotions:%lu levelDowns:%lu rle:%lu overflows:%lu maxLevel:%lu longHits:%lu \n",
+                        (unsigned long)stats.hashLookups, (unsigned long)stats.chainHops, (unsigned long)stats.collisions,
+                        (unsigned long)stats.promotions, (unsigned long)stats.levelDowns, (unsigned long)stats.rleHits,
+                        (unsigned long)stats.segmentOverflows, (unsigned long)stats.maxLevel, (unsigned long)stats.longHashHits);
+        }
+        fflush(stdout);
+    }
+
+    if (g_nbStreamsMax) benchInterleaved(name, buf, size, params, nbIterations, lengths, offsets);
+
+    FREE(offsets);
+    FREE(lengths);
+    FREE(seqs);
+    MMC_free(mmc);
+}
+
+static void benchFile(const char* filename, MMC_parameters params, unsigned nbIterations)
+{
+    FILE* const f = FOPEN(filename, "rb");
+    long fileSize;
+    unsigned char* buf;
+    size_t size;
+    if (fseek(f, 0, SEEK_END) != 0) EXIT_ERROR("cannot seek", filename);
+    fileSize = ftell(f);
+    if (fileSize < 0) EXIT_ERROR("cannot get size of", filename);
+    if (fseek(f, 0, SEEK_SET) != 0) EXIT_ERROR("cannot seek", filename);
+    buf = (unsigned char*)MALLOC((size_t)fileSize + 1);
+    size = FREAD(buf, 1, (size_t)fileSize, f);
+    FCLOSE(f);
+    benchBuffer(filename, buf, size, params, nbIterations);
+    FREE(buf);
+}
+
+static int usage(const char* exename)
+{
+    printf("usage : %s [-i#] [-w#] [-h#] [-m#] [-s#] [-p] [-n#] [FILES] \n", exename);
+    printf(" -i# : nb of measured iterations, after 1 warmup (default : %u) \n", NB_ITERATIONS_DEFAULT);
+    printf(" -w# : windowLog (default : 16) \n");
+    printf(" -h# : hashLog (default : windowLog-1) \n");
+    printf(" -m# : minMatch (default : 4) \n");
+    printf(" -s# : size of synthetic corpora, in KB (default : %u) \n", (unsigned)(SYNTHETIC_SIZE_DEFAULT >> 10));
+    printf(" -p  : profile with hardware counters (Linux perf_event_open) \n");
+    printf(" -n# : also search independent streams of %u KB, interleaved by 1, 2, 4, ... up to # (max %u) \n",
+            (unsigned)(STREAM_SIZE >> 10), MAX_STREAMS);
+    printf("without FILES, benchmarks built-in synthetic corpora \n");
+    return 1;
+}
+
+int main(int argc, const char** argv)
+{
+    const char* const exename = argv[0];
+    MMC_parameters params;
+    unsigned nbIterations = NB_ITERATIONS_DEFAULT;
+    size_t syntheticSize = SYNTHETIC_SIZE_DEFAULT;
+    int argNb, nbFiles = 0;
+
+    memset(&params, 0, sizeof(params));
+    for (argNb=1; argNb<argc; argNb++) {
+        const char* const arg = argv[argNb];
+        if (arg[0] != '-') { nbFiles++; continue; }
+        switch (arg[1]) {
+            case 'i': nbIterations = (unsigned)atoi(arg+2); break;
+            case 'w': params.windowLog = (unsigned)atoi(arg+2); break;
+            case 'h': params.hashLog = (unsigned)atoi(arg+2); break;
+            case 'm': params.minMatch = (unsigned)atoi(arg+2); break;
+            case 's': syntheticSize = (size_t)atoi(arg+2) KB; break;
+            case 'p': g_profile = 1; break;
+            case 'n': g_nbStreamsMax = MIN((unsigned)atoi(arg+2), MAX_STREAMS); break;
+            default : return usage(exename);
+    }   }
+    if (nbIterations == 0) nbIterations = 1;
+    if (g_profile) {
+        if (PERF_init(&g_perf) == 0) {
+            printf("hardware counters not available (requires Linux, and perf_event_paranoid <= 2) \n");
+            g_profile = 0;
+    }   }
+
+    printf("%-16s %-7s %10s %9s %10s %9s %12s %8s \n",
+            "corpus", "mode", "size", "MB/s", "matches/KB", "avg len", "matched", "covered");
+    if (nbFiles) {
+        for (argNb=1; argNb<argc; argNb++)
+            if (argv[argNb][0] != '-') benchFile(argv[argNb], params, nbIterations);
+    } else {
+        unsigned char* const buf = (unsigned char*)MALLOC(syntheticSize + 1);
+        size_t c;
+        for (c=0; c<sizeof(syntheticCorpora)/sizeof(syntheticCorpora[0]); c++) {
+            syntheticCorpora[c].generate(buf, syntheticSize);
+            benchBuffer(syntheticCorpora[c].name, buf, syntheticSize, params, nbIterations);
+        }
+        FREE(buf);
+    }
+    if (g_profile) PERF_free(&g_perf);
+    return 0;
+}
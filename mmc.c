@@ -28,9 +28,11 @@
 /* **********************************************************
 * Includes
 ************************************************************/
+#if defined(MMC_LARGE_PAGES) && MMC_LARGE_PAGES && defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* MAP_ANONYMOUS, MAP_HUGETLB, MADV_HUGEPAGE */
+#endif
 #include <stdlib.h>
 #define ALLOCATOR(s) calloc(1,s)
-#define REALLOCATOR(p,s) realloc(p,s)
 #define FREEMEM free
 #include <string.h>
 #define MEM_INIT memset
@@ -43,26 +45,18 @@
 /* ***********************************************************
 *  Constants
 ************************************************************/
-#define MINMATCH 4              /* Note : for the time being, this cannot be changed */
-#define DICTIONARY_LOGSIZE 16   /* Dictionary Size as a power of 2 (ex : 2^16 = 64K) */
-                                /* Total RAM allocated is 10x Dictionary (ex : Dictionary 64K ==> 640K) */
-
-#define MAXD (1 << DICTIONARY_LOGSIZE)
-#define MAXD_MASK ((U32)(MAXD - 1))
-#define MAX_DISTANCE (MAXD - 1)
-
-#define HASH_LOG (DICTIONARY_LOGSIZE-1)
-#define HASHTABLESIZE (1 << HASH_LOG)
-#define HASH_MASK (HASHTABLESIZE - 1)
-
-#define MAX_LEVELS_LOG (DICTIONARY_LOGSIZE-1)
-#define MAX_LEVELS (1U<<MAX_LEVELS_LOG)
-#define MAX_LEVELS_MASK (MAX_LEVELS-1)
+#define MINMATCH_DEFAULT 4
+#define WINDOWLOG_DEFAULT 16    /* Dictionary Size as a power of 2 (ex : 2^16 = 64K) */
+#define HASHLOG_DEFAULT_MAX 22  /* default hashLog is windowLog-1, up to this value */
+                                /* RAM allocated : see MMC_estimateCtxSize() (ex : Dictionary 64K ==> 1.5 MB) */
 
 #define NBCHARACTERS 256
-#define NB_INITIAL_SEGMENTS 16
+#define STEPNB_MAX (1U << 31)   /* trackStep generations are restarted beyond this value */
+#define CACHELINE_SIZE 64
+#define ALIGN_CACHELINE(s) (((s) + CACHELINE_SIZE-1) & ~(size_t)(CACHELINE_SIZE-1))
+#define MIN(a,b) ((a)<(b) ? (a) : (b))
+#define MAX(a,b) ((a)>(b) ? (a) : (b))
 
-#define LEVEL_DOWN ((BYTE*)1)
 
 
 /* **********************************************************
@@ -81,175 +75,1026 @@
 #  define assert(condition) ((void)0)   /* disable assert (default) */
 #endif
 
+/* MMC_STATS :
+ * when set to 1, searches update internal counters, readable with MMC_getStats().
+ * Disabled by default : counters are then compiled out. */
+#ifndef MMC_STATS
+#  define MMC_STATS 0
+#endif
+
+
+/* **********************************************************
+*  Compiler specifics
+************************************************************/
+#if defined(_MSC_VER)
+#  define FORCE_INLINE static __forceinline
+#elif defined(__GNUC__)
+#  define FORCE_INLINE static __inline __attribute__((always_inline))
+#elif defined (__cplusplus) || (defined (__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L) /* C99 */)
+#  define FORCE_INLINE static inline
+#else
+#  define FORCE_INLINE static
+#endif
+
+#if defined(_MSC_VER)
+#  define FORCE_NOINLINE static __declspec(noinline)
+#elif defined(__GNUC__)
+#  define FORCE_NOINLINE static __attribute__((noinline))
+#else
+#  define FORCE_NOINLINE static
+#endif
+
+#if defined(__GNUC__) && ((__GNUC__ > 3) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 1)))
+#  define PREFETCH(p) __builtin_prefetch((const void*)(p), 0, 3)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#  include <mmintrin.h>   /* _mm_prefetch */
+#  define PREFETCH(p) _mm_prefetch((const char*)(const void*)(p), _MM_HINT_T0)
+#else
+#  define PREFETCH(p) (void)(p)
+#endif
+
+
+/* **********************************************************
+*  Tuning parameters
+************************************************************/
+/* MMC_INDEX_MODE :
+ * Select how positions are stored into hash and chain tables.
+ * Method 0 : raw pointers. Historical layout.
+ * Method 1 (default) : 32-bit indices, relative to the searched buffer.
+ *            Halves tables size on 64-bit systems, hence fewer cache misses.
+ *            Also required to search across non-contiguous buffers (MMC_continue()).
+ *            Indices are rebased every 3 GB of input; MMC_continue() size is limited to 3 GB.
+ * Both methods produce identical results. */
+#ifndef MMC_INDEX_MODE   /* can be defined externally, on command line for example */
+#  define MMC_INDEX_MODE 1
+#endif
+
+/* MMC_PREFETCH :
+ * Software prefetching, to hide cache misses on large windows.
+ * 0 : disabled.
+ * 1 (default) : each search hashes position ip+MMC_PREFETCH_DISTANCE, and prefetches its hash bucket
+ *     and its chain slot, so that they are in cache when this position is searched or inserted.
+ *     While walking chains, slots and data of next candidates are prefetched one step ahead.
+ * Both methods produce identical results. */
+#ifndef MMC_PREFETCH   /* can be defined externally, on command line for example */
+#  define MMC_PREFETCH 1
+#endif
+#ifndef MMC_PREFETCH_DISTANCE
+#  define MMC_PREFETCH_DISTANCE 4   /* in positions */
+#endif
+
+/* MMC_MULTITHREAD :
+ * 0 (default) : MMC_parseMT() parses its blocks sequentially, in calling thread.
+ * 1 : MMC_parseMT() runs worker threads, using POSIX threads; link with -pthread. */
+#ifndef MMC_MULTITHREAD   /* can be defined externally, on command line for example */
+#  define MMC_MULTITHREAD 0
+#endif
+#if MMC_MULTITHREAD
+#  include <pthread.h>
+#endif
+
+/* MMC_GUARD :
+ * Protection against pathological inputs (periodic patterns, long repetitions),
+ * on which each search may examine a very large number of candidates, or count very long matches.
+ * 0 : disabled.
+ * 1 (default) : a context measures the work of recent searches (candidates examined + bytes compared / 16).
+ *     When the average exceeds MMC_GUARD_BUDGET per position, it switches to a shallow search mode,
+ *     which examines at most MMC_GUARD_ATTEMPTS candidates, stops on finding a match of MMC_GUARD_NICE bytes,
+ *     and doesn't measure matches beyond 16 * MMC_GUARD_NICE bytes.
+ *     It switches back to normal once shallow searches stop reaching these limits.
+ *     Inputs which never exceed the budget are not affected. */
+#ifndef MMC_GUARD   /* can be defined externally, on command line for example */
+#  define MMC_GUARD 1
+#endif
+#ifndef MMC_GUARD_BUDGET
+#  define MMC_GUARD_BUDGET   512   /* average work units per position */
+#endif
+#ifndef MMC_GUARD_ATTEMPTS
+#  define MMC_GUARD_ATTEMPTS  16
+#endif
+#ifndef MMC_GUARD_NICE
+#  define MMC_GUARD_NICE     256
+#endif
+#define MMC_GUARD_SPANLOG      6   /* average over roughly 64 recent searches */
+
+/* MMC_VECTOR_COUNT :
+ * Select how match lengths are measured.
+ * Method 0 : compare one word (size_t) at a time. Portable.
+ * Method 1 (default) : compare 32 bytes (AVX2) or 16 bytes (SSE2, NEON) at a time,
+ *            when the target supports it (detected at compile time), followed by words.
+ * Both methods produce identical results. */
+#ifndef MMC_VECTOR_COUNT   /* can be defined externally, on command line for example */
+#  define MMC_VECTOR_COUNT 1
+#endif
+
+#if MMC_VECTOR_COUNT && defined(__AVX2__)
+#  include <immintrin.h>
+#  define MMC_VECTOR_SIZE 32
+#elif MMC_VECTOR_COUNT && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#  include <emmintrin.h>
+#  define MMC_VECTOR_SIZE 16
+#elif MMC_VECTOR_COUNT && (defined(__ARM_NEON) || defined(__ARM_NEON__)) && defined(__aarch64__)
+#  include <arm_neon.h>
+#  define MMC_VECTOR_SIZE 16
+#  define MMC_VECTOR_NEON 1
+#else
+#  define MMC_VECTOR_SIZE 0
+#endif
+#ifndef MMC_VECTOR_NEON
+#  define MMC_VECTOR_NEON 0
+#endif
+
+/* MMC_HASH_TAGS :
+ * when set to 1, each hash bucket also summarizes which sequences its chain holds,
+ * as a 16-bit set of fingerprints (4 hash bits not used for bucket selection).
+ * A search for a sequence whose fingerprint is absent can't find any candidate :
+ * it skips the walk through hash collisions, without reading chainTable nor input.
+ * Fingerprints are kept for 2 periods of at least window size, so no candidate within window is ever missed :
+ * results are unchanged. hashTable becomes 3x larger.
+ * Most useful on high entropy data, where most sequences are new; repetitive data mostly pays the larger table. */
+#ifndef MMC_HASH_TAGS   /* can be defined externally, on command line for example */
+#  define MMC_HASH_TAGS 0
+#endif
+
+/* MMC_LONG_HASH :
+ * when set to 1, a second table, of 1 << hashLog entries, remembers the most recent position of each 8-byte sequence.
+ * Searches for the best match probe it first : a long candidate found there becomes the match to beat,
+ * and a search reaching niceLength this way stops immediately.
+ * With maxAttempts, long matches beyond the few candidates examined are still found.
+ * Chains are maintained as usual. Not used when minMatch is 8, nor to list all matches.
+ * Without search limits, match lengths are unchanged, but an equally long candidate may be farther.
+ * Costs one more table access per position : most useful on repetitive data searched with limits. */
+#ifndef MMC_LONG_HASH   /* can be defined externally, on command line for example */
+#  define MMC_LONG_HASH 0
+#endif
+
+/* MMC_LARGE_PAGES :
+ * when set to 1 (Linux only), contexts of 2 MB or more allocated without custom allocator
+ * are backed by an anonymous mapping, using explicit huge pages (MAP_HUGETLB) when some are reserved,
+ * or else transparent huge pages (madvise(MADV_HUGEPAGE)). calloc() remains the fallback.
+ * With large windows, random accesses into chainTable then miss the TLB less often.
+ * Mapped tables are also erased by releasing their pages, instead of writing zeros. */
+#ifndef MMC_LARGE_PAGES   /* can be defined externally, on command line for example */
+#  define MMC_LARGE_PAGES 0
+#endif
+#if MMC_LARGE_PAGES && defined(__linux__)
+#  include <sys/mman.h>   /* mmap, madvise, munmap */
+#  define MMC_MMAP 1
+#  define HUGEPAGE_SIZE ((size_t)2 << 20)
+#else
+#  define MMC_MMAP 0
+#endif
+
+/* MMC_LEVELLOG_MAX :
+ * levelList holds one entry per level (match length) active during a search, used modulo its size.
+ * It has 1 << (windowLog-1) entries, but no more than 1 << MMC_LEVELLOG_MAX,
+ * so that its size stops growing with large windows.
+ * A search stops creating levels before they would wrap around, and keeps the best match found so far. */
+#ifndef MMC_LEVELLOG_MAX   /* can be defined externally, on command line for example */
+#  define MMC_LEVELLOG_MAX 16
+#endif
+
 
 /* **********************************************************
 *  Local Types
 ************************************************************/
+#if MMC_INDEX_MODE
+typedef U32 MMC_pos_t;
+#else
+typedef const BYTE* MMC_pos_t;
+#endif
+
 typedef struct {
-    const BYTE* levelUp;
-    const BYTE* nextTry;
+    MMC_pos_t levelUp;
+    MMC_pos_t nextTry;
 } selectNextHop_t;
 
 typedef struct {
-    const BYTE* position;
+    MMC_pos_t position;
     U32   size;
 } segmentInfo_t;
 
+#if MMC_HASH_TAGS
+typedef struct {
+    MMC_pos_t head;                 /* most recent position */
+    MMC_pos_t epoch;                /* start of current period */
+    U32 tags;                       /* fingerprints inserted during current period (low 16 bits) and previous one (high 16 bits) */
+} hashBucket_t;
+#else
+typedef MMC_pos_t hashBucket_t;
+#endif
+
 typedef struct {
-    segmentInfo_t * segments;
-    U16 start;
-    U16 max;
+    segmentInfo_t * segments;       /* segmentsMax entries; [0] is a sentinel */
+    U32 start;
 } segmentTracker_t;
 
 struct MMC_ctx_s
 {
     const BYTE* beginBuffer;        /* First byte of data buffer being searched */
-    const BYTE* lastPosInserted;    /* excluded */
-    const BYTE* hashTable[HASHTABLESIZE];
-    selectNextHop_t chainTable[MAXD];
+    const BYTE* nextSrc;            /* end of data seen so far within current buffer */
+    const BYTE* base;               /* index 0 of current buffer; only used by MMC_INDEX_MODE */
+    const BYTE* dictBase;           /* index 0 of previous buffer, for indexes < dictLimit */
+    U32 dictLimit;                  /* index of beginBuffer */
+    U32 lowLimit;                   /* lowest valid index */
+    hashBucket_t* hashTable;        /* 1 << hashLog entries */
+    MMC_pos_t* longHashTable;       /* 1 << hashLog entries, only used by MMC_LONG_HASH; directly follows hashTable */
+    selectNextHop_t* chainTable;    /* 1 << windowLog entries */
+    MMC_pos_t* levelList;           /* 1 << LEVELLOG(windowLog) entries */
+    U32 windowLog;
+    U32 hashLog;
+    U32 minMatch;
+    U32 maxDistance;
+    U32 maxAttempts;
+    U32 niceLength;
+    U32 segmentsMax;                /* capacity of each list of RLE segments */
+    U32 workAvg;                    /* recent work per search, scaled by 1<<MMC_GUARD_SPANLOG */
+    U32 shallow;                    /* 1 : pathological input, searches are bounded */
+    void* workspace;                /* allocation holding context and tables; NULL for static contexts */
+    size_t mapSize;                 /* >0 : workspace is within a mapping of this size, starting at mapBase */
+    void* mapBase;
+    MMC_customMem customMem;
     segmentTracker_t segments[NBCHARACTERS];
-    const BYTE* levelList[MAX_LEVELS];
-    const BYTE** trackPtr[NBCHARACTERS];
-    U16 trackStep[NBCHARACTERS];
+    MMC_pos_t* trackPtr[NBCHARACTERS];
+    U32 trackStep[NBCHARACTERS];    /* step at which each character was last met; older steps are stale */
+    U32 stepNb;                     /* first step of next search */
+#if MMC_STATS
+    MMC_stats_t stats;              /* since last MMC_init() */
+#endif
 };  /* typedef'd to MMC_ctx within "mmc.h" */
 
 
 /* **********************************************************
 *  Macros
 ************************************************************/
-#define HASH_VALUE(p)    MMC_hash(MEM_read32(p))
-#define NEXT_TRY(p)      chainTable[(size_t)(p) & MAXD_MASK].nextTry
-#define LEVEL_UP(p)      chainTable[(size_t)(p) & MAXD_MASK].levelUp
-#define ADD_HASH(p)      { NEXT_TRY(p) = HashTable[HASH_VALUE(p)]; LEVEL_UP(p)=0; HashTable[HASH_VALUE(p)] = p; }
-#define LEVEL(l)         levelList[(l)&MAX_LEVELS_MASK]
+/* these macros expect base, dictBase, dictLimit, chainMask, hashLog, mls and levelMask to be defined locally */
+#if MMC_INDEX_MODE
+#  define POS(p)         ((MMC_pos_t)((p) - base))
+#  define PTR(r)         (((r) < dictLimit ? dictBase : base) + (r))
+#  define INDEX_START(ctx) (2*((ctx)->maxDistance+1))   /* room below first index, so that out-of-range positions remain > LEVEL_DOWN */
+#  define INDEX_MAX      (3U << 30)
+#else
+#  define POS(p)         (p)
+#  define PTR(r)         (r)
+#endif
+#define LEVEL_DOWN       ((MMC_pos_t)1)
+#define HASH_VALUE(p)    MMC_hash(MMC_readSequence(p, mls), hashLog, mls)
+#define NEXT_TRY(r)      chainTable[(size_t)(r) & chainMask].nextTry
+#define LEVEL_UP(r)      chainTable[(size_t)(r) & chainMask].levelUp
+#if MMC_HASH_TAGS
+#  define HEAD(h)          HashTable[h].head
+#  define TAG_BIT(p)       (1U << MMC_hashTag(MMC_readSequence(p, mls), hashLog, mls))
+#  define ADD_TAG(h, p)    { hashBucket_t* const b_ = HashTable + (h);                                 \
+                             if ((size_t)(POS(p) - b_->epoch) > maxDistance) { b_->tags <<= 16; b_->epoch = POS(p); }  \
+                             b_->tags |= TAG_BIT(p); }
+#else
+#  define HEAD(h)          HashTable[h]
+#  define ADD_TAG(h, p)    {}
+#endif
+#define ADD_HASH(p)      { U32 const h_ = HASH_VALUE(p); NEXT_TRY(POS(p)) = HEAD(h_); LEVEL_UP(POS(p))=0; ADD_TAG(h_, p); HEAD(h_) = POS(p); }
+#define LONG_LENGTH      8
+#define LONG_HASH_VALUE(p) MMC_hash(MEM_readLE64(p), hashLog, LONG_LENGTH)
+#define LEVEL(l)         levelList[(l)&levelMask]
+#define LEVELLOG(wlog)   MIN((wlog)-1, MMC_LEVELLOG_MAX)
+#if MMC_STATS
+#  define STATS_ADD(f, n)  { MMC->stats.f += (n); }
+#  define STATS_MAX(f, v)  { if ((v) > MMC->stats.f) MMC->stats.f = (v); }
+#else
+#  define STATS_ADD(f, n)  {}
+#  define STATS_MAX(f, v)  {}
+#endif
+#if MMC_PREFETCH
+#  define PREFETCH_AHEAD(p, limit) { if ((p) + MMC_PREFETCH_DISTANCE + MMC_READSIZE(mls) <= (limit)) {  \
+                                         PREFETCH(HashTable + HASH_VALUE((p) + MMC_PREFETCH_DISTANCE));  \
+                                         PREFETCH(&NEXT_TRY(POS((p) + MMC_PREFETCH_DISTANCE))); }        \
+                                     PREFETCH_LONG(p, limit); }
+#  if MMC_LONG_HASH
+#    define PREFETCH_LONG(p, limit) { if ((mls < LONG_LENGTH) && ((p) + MMC_PREFETCH_DISTANCE + LONG_LENGTH <= (limit)))  \
+                                          PREFETCH(LongHashTable + LONG_HASH_VALUE((p) + MMC_PREFETCH_DISTANCE)); }
+#  else
+#    define PREFETCH_LONG(p, limit) {}
+#  endif
+#  define PREFETCH_REF(r)          { PREFETCH(&NEXT_TRY(r)); PREFETCH(PTR(r)); }
+#else
+#  define PREFETCH_AHEAD(p, limit) {}
+#  define PREFETCH_REF(r)          {}
+#endif
 
 
 /* **********************************************************
 *  Object Allocation
 ************************************************************/
+static void* MMC_calloc(size_t size, MMC_customMem customMem)
+{
+    if (customMem.customAlloc) {
+        void* const ptr = customMem.customAlloc(customMem.opaque, size);
+        if (ptr != NULL) MEM_INIT(ptr, 0, size);
+        return ptr;
+    }
+    return ALLOCATOR(size);
+}
+
+static void MMC_customFree(void* ptr, MMC_customMem customMem)
+{
+    if (ptr == NULL) return;
+    if (customMem.customFree) customMem.customFree(customMem.opaque, ptr);
+    else FREEMEM(ptr);
+}
+
+#if MMC_MMAP
+/* MMC_mapWorkspace() :
+ * @return : zero-filled memory of at least size bytes, starting on a huge page boundary; NULL on failure.
+ *           *mapBase and *mapSize receive the mapping to release */
+static void* MMC_mapWorkspace(size_t size, void** mapBase, size_t* mapSize)
+{
+    size_t const hugeSize = (size + HUGEPAGE_SIZE-1) & ~(HUGEPAGE_SIZE-1);
+    void* ptr;
+
+    /* explicit huge pages : only available if reserved by administrator (vm.nr_hugepages) */
+    ptr = mmap(NULL, hugeSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED) { *mapBase = ptr; *mapSize = hugeSize; return ptr; }
+
+    /* transparent huge pages : one more huge page, to start on a boundary */
+    ptr = mmap(NULL, hugeSize + HUGEPAGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return NULL;
+    *mapBase = ptr;
+    *mapSize = hugeSize + HUGEPAGE_SIZE;
+    ptr = (BYTE*)ptr + ((HUGEPAGE_SIZE - ((size_t)ptr & (HUGEPAGE_SIZE-1))) & (HUGEPAGE_SIZE-1));
+#  ifdef MADV_HUGEPAGE
+    (void)madvise(ptr, hugeSize, MADV_HUGEPAGE);   /* only a hint : failure is harmless */
+#  endif
+    return ptr;
+}
+#endif
+
+/* MMC_tablesSize() :
+ * size of chainTable, hashTable and longHashTable, which are contiguous */
+static size_t MMC_tablesSize(const MMC_ctx* ctx)
+{
+    return ((size_t)1 << ctx->windowLog) * sizeof(*ctx->chainTable)
+         + ((size_t)1 << ctx->hashLog) * (sizeof(*ctx->hashTable) + MMC_LONG_HASH * sizeof(*ctx->longHashTable));
+}
+
+/* MMC_clearTables() :
+ * erase chainTable, hashTable and longHashTable */
+static void MMC_clearTables(MMC_ctx* ctx)
+{
+    BYTE* const start = (BYTE*)ctx->chainTable;
+    size_t const size = MMC_tablesSize(ctx);
+#if MMC_MMAP
+    if (ctx->mapSize) {
+        /* anonymous mapping : released pages read back as zeros on next access */
+        BYTE* const alignedStart = (BYTE*)(((size_t)start + HUGEPAGE_SIZE-1) & ~(HUGEPAGE_SIZE-1));
+        BYTE* const alignedEnd = (BYTE*)(((size_t)start + size) & ~(HUGEPAGE_SIZE-1));
+        if ((alignedEnd > alignedStart) && !madvise(alignedStart, (size_t)(alignedEnd - alignedStart), MADV_DONTNEED)) {
+            MEM_INIT(start, 0, (size_t)(alignedStart - start));
+            MEM_INIT(alignedEnd, 0, (size_t)(start + size - alignedEnd));
+            return;
+    }   }
+#endif
+    MEM_INIT(start, 0, size);
+}
+
+/* MMC_adjustParams() :
+ * replace 0 fields by their default value.
+ * @return : 0 if parameters are valid, 1 otherwise */
+static size_t MMC_adjustParams(MMC_parameters* params)
+{
+    if (params->windowLog == 0) params->windowLog = WINDOWLOG_DEFAULT;
+    if (params->hashLog == 0) params->hashLog = MIN(params->windowLog - 1, HASHLOG_DEFAULT_MAX);
+    if (params->minMatch == 0) params->minMatch = MINMATCH_DEFAULT;
+    if ((params->windowLog < MMC_WINDOWLOG_MIN) || (params->windowLog > MMC_WINDOWLOG_MAX)) return 1;
+    if ((params->hashLog < MMC_HASHLOG_MIN) || (params->hashLog > MMC_HASHLOG_MAX)) return 1;
+    if ((params->minMatch < MMC_MINMATCH_MIN) || (params->minMatch > MMC_MINMATCH_MAX)) return 1;
+    return 0;
+}
+
+/* workspace layout : context, followed by its tables, each starting on a cache line.
+ * Table sizes are multiples of CACHELINE_SIZE; hashTable directly follows chainTable, and longHashTable hashTable. */
+#define CTX_SIZE          ALIGN_CACHELINE(sizeof(MMC_ctx))
+#define CHAIN_SIZE(p)     (((size_t)1 << (p).windowLog) * sizeof(selectNextHop_t))
+#define HASH_SIZE(p)      (((size_t)1 << (p).hashLog) * (sizeof(hashBucket_t) + MMC_LONG_HASH * sizeof(MMC_pos_t)))
+#define LEVEL_SIZE(p)     (((size_t)1 << LEVELLOG((p).windowLog)) * sizeof(MMC_pos_t))
+#define SEGMENTS_SIZE(p)  (NBCHARACTERS * MMC_segmentsMax(p) * sizeof(segmentInfo_t))
+#define WORKSPACE_SIZE(p) (CACHELINE_SIZE-1 + CTX_SIZE + CHAIN_SIZE(p) + HASH_SIZE(p) + LEVEL_SIZE(p) + SEGMENTS_SIZE(p))
+
+/* MMC_segmentsMax() :
+ * capacity of the list of runs (RLE segments) tracked for each byte value,
+ * large enough to never drop a segment within window, so that searches and insertions never allocate.
+ * Listed segments within window have strictly decreasing lengths, of at least minMatch, and are separated :
+ * besides the oldest one, m segments occupy at least sum(minMatch+2+j, j<m) bytes of window. */
+static U32 MMC_segmentsMax(MMC_parameters params)
+{
+    size_t const windowSize = (size_t)1 << params.windowLog;
+    size_t used = 0;
+    U32 m = 0;
+    while (used + params.minMatch + 2 + m <= windowSize) { used += params.minMatch + 2 + m; m++; }
+    return m + 3;   /* + oldest segment, new one, and sentinel */
+}
+
+size_t MMC_estimateCtxSize(MMC_parameters params)
+{
+    if (MMC_adjustParams(&params)) return 0;
+    return WORKSPACE_SIZE(params);
+}
+
+/* MMC_layoutCtx() :
+ * build a context within workspace, which must be WORKSPACE_SIZE(params) bytes.
+ * Tables are expected to be already zeroed. */
+static MMC_ctx* MMC_layoutCtx(void* workspace, MMC_parameters params)
+{
+    BYTE* const start = (BYTE*)workspace + ((CACHELINE_SIZE - ((size_t)workspace & (CACHELINE_SIZE-1))) & (CACHELINE_SIZE-1));
+    MMC_ctx* const ctx = (MMC_ctx*)(void*)start;
+    MEM_INIT(ctx, 0, sizeof(*ctx));
+    ctx->chainTable = (selectNextHop_t*)(void*)(start + CTX_SIZE);
+    ctx->hashTable = (hashBucket_t*)(void*)((BYTE*)ctx->chainTable + CHAIN_SIZE(params));
+    ctx->longHashTable = (MMC_pos_t*)(void*)(ctx->hashTable + ((size_t)1 << params.hashLog));
+    ctx->levelList = (MMC_pos_t*)(void*)((BYTE*)ctx->hashTable + HASH_SIZE(params));
+    {   segmentInfo_t* const segments = (segmentInfo_t*)(void*)((BYTE*)ctx->levelList + LEVEL_SIZE(params));
+        int c;
+        ctx->segmentsMax = MMC_segmentsMax(params);
+        for (c=0; c<NBCHARACTERS; c++) ctx->segments[c].segments = segments + (size_t)c * ctx->segmentsMax;
+    }
+    ctx->windowLog = params.windowLog;
+    ctx->hashLog = params.hashLog;
+    ctx->minMatch = params.minMatch;
+    ctx->maxDistance = (1U << params.windowLog) - 1;
+    ctx->maxAttempts = params.maxAttempts ? params.maxAttempts : (U32)-1;
+    ctx->niceLength = params.niceLength ? params.niceLength : (U32)-1;
+    ctx->stepNb = 1;   /* 0 marks a shut down chain in trackStep */
+    return ctx;
+}
+
+MMC_ctx* MMC_initStatic(void* workspace, size_t workspaceSize, MMC_parameters params)
+{
+    if (workspace == NULL) return NULL;
+    if (MMC_adjustParams(&params)) return NULL;
+    if (workspaceSize < WORKSPACE_SIZE(params)) return NULL;
+    MEM_INIT(workspace, 0, WORKSPACE_SIZE(params));
+    return MMC_layoutCtx(workspace, params);   /* ctx->workspace==NULL : not released by MMC_free() */
+}
+
+MMC_ctx* MMC_createWithAllocator (MMC_parameters params, MMC_customMem customMem)
+{
+    MMC_ctx* ctx;
+    void* workspace;
+    if ((customMem.customAlloc == NULL) != (customMem.customFree == NULL)) return NULL;   /* both or none */
+    if (MMC_adjustParams(&params)) return NULL;
+
+    /* single allocation : context, followed by its tables */
+#if MMC_MMAP
+    if ((customMem.customAlloc == NULL) && (WORKSPACE_SIZE(params) >= HUGEPAGE_SIZE)) {
+        void* mapBase;
+        size_t mapSize;
+        workspace = MMC_mapWorkspace(WORKSPACE_SIZE(params), &mapBase, &mapSize);
+        if (workspace != NULL) {
+            ctx = MMC_layoutCtx(workspace, params);
+            ctx->mapBase = mapBase;
+            ctx->mapSize = mapSize;
+            return ctx;
+    }   }
+#endif
+    workspace = MMC_calloc(WORKSPACE_SIZE(params), customMem);
+    if (workspace == NULL) return NULL;
+    ctx = MMC_layoutCtx(workspace, params);
+    ctx->workspace = workspace;
+    ctx->customMem = customMem;
+    return ctx;
+}
+
+MMC_ctx* MMC_createAdvanced (MMC_parameters params)
+{
+    MMC_customMem const defaultMem = { NULL, NULL, NULL };
+    return MMC_createWithAllocator(params, defaultMem);
+}
+
 MMC_ctx* MMC_create (void)
 {
-    return (MMC_ctx*) ALLOCATOR(sizeof(MMC_ctx));
+    MMC_parameters params;
+    params.windowLog = 0;
+    params.hashLog = 0;
+    params.minMatch = 0;
+    params.maxAttempts = 0;
+    params.niceLength = 0;
+    return MMC_createAdvanced(params);
 }
 
 size_t MMC_init(MMC_ctx* MMC, const void* beginBuffer)
 {
+    MMC_pos_t firstPos;
+#if MMC_INDEX_MODE
+    /* Reusing a context : new indexes start beyond previous ones, and lowLimit excludes older content.
+     * Tables only need a reset when index space runs low; a new context starts with zeroed tables. */
+    firstPos = INDEX_START(MMC);
+    if (MMC->nextSrc != NULL) {
+        size_t const prevEnd = (size_t)(MMC->nextSrc - MMC->base);   /* can exceed 4 GB, after searching a single large buffer */
+        if (prevEnd < INDEX_MAX/2) {
+            firstPos = MAX((U32)prevEnd + 1, firstPos);
+        } else {
+            MMC_clearTables(MMC);
+    }   }
+    MMC->beginBuffer = (const BYTE*)beginBuffer;
+    MMC->nextSrc = MMC->beginBuffer;
+    MMC->workAvg = 0;
+    MMC->shallow = 0;
+#if MMC_STATS
+    MEM_INIT(&MMC->stats, 0, sizeof(MMC->stats));
+#endif
+    MMC->base = MMC->beginBuffer - firstPos;
+    MMC->dictBase = MMC->base;
+    MMC->dictLimit = MMC->lowLimit = firstPos;
+#else
+    /* raw pointers can't be invalidated : previous content must be erased */
     MMC->beginBuffer = (const BYTE*)beginBuffer;
-    MMC->lastPosInserted = MMC->beginBuffer;
-    MEM_INIT(MMC->chainTable, 0, sizeof(MMC->chainTable));
-    MEM_INIT(MMC->hashTable,  0, sizeof(MMC->hashTable));
+    MMC->nextSrc = MMC->beginBuffer;
+    MMC->workAvg = 0;
+    MMC->shallow = 0;
+#if MMC_STATS
+    MEM_INIT(&MMC->stats, 0, sizeof(MMC->stats));
+#endif
+    firstPos = MMC->beginBuffer;
+    MMC_clearTables(MMC);
+#endif
     /* Init RLE detector */
     {   int c;
         for (c=0; c<NBCHARACTERS; c++) {
-            segmentInfo_t* const newSegment = REALLOCATOR(MMC->segments[c].segments, NB_INITIAL_SEGMENTS * sizeof(segmentInfo_t));
-            if (newSegment == NULL) return 1;   /* realloc failed : existing segment is preserved */
-            MMC->segments[c].segments = newSegment;
-            MMC->segments[c].max = NB_INITIAL_SEGMENTS;
             MMC->segments[c].start = 0;
             MMC->segments[c].segments[0].size = -1;
-            MMC->segments[c].segments[0].position = (const BYTE*)beginBuffer - (MAX_DISTANCE+1);
+            MMC->segments[c].segments[0].position = firstPos - (MMC->maxDistance+1);
     }   }
     return 0;
 }
 
 
+#if MMC_INDEX_MODE
+/* MMC_reduceIndex() :
+ * shift all stored indexes down by reducer, to prevent index overflow.
+ * Indexes below lowLimit are out of reach : they are clamped to 2,
+ * which remains distinct from 0 and LEVEL_DOWN.
+ * reducer can exceed 4 GB : all stored indexes are then out of reach. */
+static void MMC_reduceIndex(MMC_ctx* MMC, size_t reducer)
+{
+#define REDUCE(v) ((v) < 2 ? (v) : ((size_t)(v) < reducer+2 ? 2 : (v)-(U32)reducer))
+    size_t const chainSize = (size_t)1 << MMC->windowLog;
+    size_t const hashSize = (size_t)1 << MMC->hashLog;
+    size_t u;
+    for (u=0; u<chainSize; u++) {
+        MMC->chainTable[u].levelUp = REDUCE(MMC->chainTable[u].levelUp);
+        MMC->chainTable[u].nextTry = REDUCE(MMC->chainTable[u].nextTry);
+    }
+#if MMC_HASH_TAGS
+    for (u=0; u<hashSize; u++) {
+        MMC->hashTable[u].head = REDUCE(MMC->hashTable[u].head);
+        MMC->hashTable[u].epoch = REDUCE(MMC->hashTable[u].epoch);   /* an earlier epoch only makes fingerprints rotate sooner */
+    }
+#else
+    for (u=0; u<hashSize; u++) MMC->hashTable[u] = REDUCE(MMC->hashTable[u]);
+#endif
+#if MMC_LONG_HASH
+    for (u=0; u<hashSize; u++) MMC->longHashTable[u] = REDUCE(MMC->longHashTable[u]);
+#endif
+    MMC->base += reducer;
+    MMC->dictBase += reducer;
+    MMC->dictLimit -= (U32)reducer;   /* modulo 2^32 : fields may hold truncated indexes, their result fits */
+    MMC->lowLimit -= (U32)reducer;
+    {   int c;
+        for (c=0; c<NBCHARACTERS; c++) {
+            segmentTracker_t* const tracker = MMC->segments + c;
+            for (u=1; u<=tracker->start; u++) tracker->segments[u].position = REDUCE(tracker->segments[u].position);
+            tracker->segments[0].position = INDEX_START(MMC) - (MMC->maxDistance+1);
+    }   }
+#undef REDUCE
+}
+#endif
+
+/* MMC_checkIndex() :
+ * within a single buffer, indexes grow with input position.
+ * Before they overflow, stored indexes are shifted down, keeping only last window reachable.
+ * Must be called before searching or inserting ip; a call may reach positions up to 1 GB beyond ip (end of a run). */
+static void MMC_checkIndex(MMC_ctx* MMC, const BYTE* ip)
+{
+#if MMC_INDEX_MODE
+    if ((size_t)(ip - MMC->base) >= INDEX_MAX) {
+        U32 const ipPos = (U32)(ip - MMC->base);
+        MMC->lowLimit = MAX(MMC->lowLimit, ipPos - MMC->maxDistance);
+        MMC->dictLimit = MAX(MMC->dictLimit, MMC->lowLimit);   /* dictionary may be out of reach */
+        {   /* chainTable is indexed by position modulo window size : reducer must preserve it */
+            U32 const reducer = (MMC->lowLimit - INDEX_START(MMC)) & ~MMC->maxDistance;
+            MMC_reduceIndex(MMC, reducer);
+    }   }
+#else
+    (void)MMC; (void)ip;
+#endif
+}
+
+size_t MMC_continue(MMC_ctx* MMC, const void* newBuffer, size_t size)
+{
+    const BYTE* const src = (const BYTE*)newBuffer;
+#if MMC_INDEX_MODE
+    size_t const dictEnd = (size_t)(MMC->nextSrc - MMC->base);   /* can exceed 4 GB, after searching a single large buffer */
+    int const overflow = (size > INDEX_MAX) || (dictEnd > INDEX_MAX - size);
+    size_t lowLimit = MMC->dictLimit;   /* current buffer becomes the dictionary; older data is no longer reachable */
+    size_t reducer = 0;
+    if (overflow) {
+        /* only the last window of dictionary remains reachable from new buffer */
+        lowLimit = MAX(lowLimit, dictEnd - (MMC->maxDistance+1));
+        /* chainTable is indexed by position modulo window size : reducer must preserve it */
+        reducer = (lowLimit - INDEX_START(MMC)) & ~(size_t)MMC->maxDistance;
+        if (size > INDEX_MAX - (dictEnd - reducer)) return 1;   /* buffer too large; context is left unmodified */
+    }
+    if ((src != MMC->nextSrc) || overflow) {
+        MMC->lowLimit = (U32)lowLimit;   /* truncated values are fixed by MMC_reduceIndex() */
+        MMC->dictLimit = (U32)dictEnd;
+        MMC->dictBase = MMC->base;
+        MMC->base = src - dictEnd;
+        MMC->beginBuffer = src;
+        if (reducer) MMC_reduceIndex(MMC, reducer);
+    }
+#else
+    if (src != MMC->nextSrc) return 1;   /* raw pointers can't describe non-contiguous buffers */
+#endif
+    MMC->nextSrc = src + size;
+    return 0;
+}
+
+
 void MMC_free (MMC_ctx* ctx)
 {
-    int c;
     if (ctx==NULL) return;  /* compatible free on NULL */
-    for (c=0; c<NBCHARACTERS; c++)   /* RLE list release */
-        FREEMEM(ctx->segments[c].segments);
-    FREEMEM(ctx);
+#if MMC_MMAP
+    if (ctx->mapSize) { (void)munmap(ctx->mapBase, ctx->mapSize); return; }
+#endif
+    MMC_customFree(ctx->workspace, ctx->customMem);   /* static contexts have no workspace to release */
 }
 
 
 /* *******************************************************************
 *  Basic Search operations (Greedy / Lazy / Flexible parsing)
 *********************************************************************/
-static U32 MMC_hash(U32 u) { return (u * 2654435761U) >> (32-HASH_LOG); }
+/* Each minimum match length (mls) gets its own code path :
+ * functions below take mls as a compile-time constant, and are specialized by the dispatchers at the end of this section.
+ * Sequences of mls <= 4 bytes are read as 32-bit values, longer ones as the top mls bytes of a 64-bit value. */
+#define MMC_READSIZE(mls) ((mls)<=4 ? 4 : 8)
+
+FORCE_INLINE U64 MMC_readSequence(const void* p, U32 mls)
+{
+    switch(mls)
+    {
+    case 3 : return MEM_readLE32(p) & 0xFFFFFF;
+    case 4 : return MEM_read32(p);
+    default: return MEM_readLE64(p) << (8*(8-mls));
+    }
+}
 
-static size_t MMC_insert_once (MMC_ctx* MMC, const void* ptr, size_t max);
+/* value of MMC_readSequence() on a run of identical bytes c */
+FORCE_INLINE U64 MMC_rleSequence(BYTE c, U32 mls)
+{
+    U64 const rle = c * 0x0101010101010101ULL;
+    switch(mls)
+    {
+    case 3 : return rle & 0xFFFFFF;
+    case 4 : return (U32)rle;
+    default: return rle << (8*(8-mls));
+    }
+}
 
-size_t MMC_insertAndFindBestMatch (MMC_ctx* MMC, const void* inputPointer, size_t maxLength, const void** matchpos)
+FORCE_INLINE U32 MMC_hash(U64 sequence, U32 hashLog, U32 mls)
+{
+    if (mls <= 4) return ((U32)sequence * 2654435761U) >> (32-hashLog);
+    return (U32)((sequence * 0xCF1BBCDCB7A56463ULL) >> (64-hashLog));
+}
+
+#if MMC_HASH_TAGS
+/* MMC_hashTag() : 4 bits following those selecting the bucket */
+FORCE_INLINE U32 MMC_hashTag(U64 sequence, U32 hashLog, U32 mls)
+{
+    if (mls <= 4) return (((U32)sequence * 2654435761U) >> (28-hashLog)) & 15;
+    return (U32)((sequence * 0xCF1BBCDCB7A56463ULL) >> (60-hashLog)) & 15;
+}
+#endif
+
+/* MMC_ctz() and MMC_clz() : v must be != 0 */
+FORCE_INLINE unsigned MMC_ctz(size_t v)
+{
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+    return MEM_64bits() ? (unsigned)__builtin_ctzll((U64)v) : (unsigned)__builtin_ctz((U32)v);
+#else
+    unsigned n = 0;
+    while (!(v & 1)) { v >>= 1; n++; }
+    return n;
+#endif
+}
+
+FORCE_INLINE unsigned MMC_clz(size_t v)
+{
+#if defined(__GNUC__) && (__GNUC__ >= 4)
+    return MEM_64bits() ? (unsigned)__builtin_clzll((U64)v) : (unsigned)__builtin_clz((U32)v);
+#else
+    unsigned n = 0;
+    while (!(v >> (sizeof(size_t)*8 - 1))) { v <<= 1; n++; }
+    return n;
+#endif
+}
+
+/* number of identical bytes, starting from lowest address, in 2 words which xor is diff (!= 0) */
+FORCE_INLINE unsigned MMC_nbCommonBytes(size_t diff)
+{
+    return (MEM_isLittleEndian() ? MMC_ctz(diff) : MMC_clz(diff)) >> 3;
+}
+
+/* same as MMC_nbCommonBytes(), starting from highest address */
+FORCE_INLINE unsigned MMC_nbCommonBytesBackward(size_t diff)
+{
+    return (MEM_isLittleEndian() ? MMC_clz(diff) : MMC_ctz(diff)) >> 3;
+}
+
+#if (MMC_VECTOR_SIZE == 32)
+/* bitmap of differing bytes among 32 */
+FORCE_INLINE U32 MMC_vectorDiff(const BYTE* p1, const BYTE* p2)
+{
+    __m256i const v1 = _mm256_loadu_si256((const __m256i*)(const void*)p1);
+    __m256i const v2 = _mm256_loadu_si256((const __m256i*)(const void*)p2);
+    return ~(U32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, v2));
+}
+#elif (MMC_VECTOR_SIZE == 16) && !MMC_VECTOR_NEON
+/* bitmap of differing bytes among 16 */
+FORCE_INLINE U32 MMC_vectorDiff(const BYTE* p1, const BYTE* p2)
+{
+    __m128i const v1 = _mm_loadu_si128((const __m128i*)(const void*)p1);
+    __m128i const v2 = _mm_loadu_si128((const __m128i*)(const void*)p2);
+    return (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2)) ^ 0xFFFF;
+}
+#elif MMC_VECTOR_NEON
+/* 4 bits per byte among 16 (no movemask on NEON); result must be divided by 4 after ctz */
+FORCE_INLINE U64 MMC_vectorDiff(const BYTE* p1, const BYTE* p2)
+{
+    uint8x16_t const eq = vceqq_u8(vld1q_u8(p1), vld1q_u8(p2));
+    uint8x8_t const nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return ~vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+}
+#endif
+
+/* MMC_count() :
+ * @return : n + number of identical bytes between ip+n and ref+n, stopping at nMax.
+ * Never reads beyond ip+nMax nor ref+nMax. */
+FORCE_INLINE U32 MMC_count(const BYTE* ip, const BYTE* ref, U32 n, U32 nMax)
+{
+#if MMC_VECTOR_SIZE
+    while (n + MMC_VECTOR_SIZE <= nMax) {
+        size_t const diff = (size_t)MMC_vectorDiff(ip+n, ref+n);
+        if (diff) return n + (MMC_ctz(diff) >> (MMC_VECTOR_NEON ? 2 : 0));
+        n += MMC_VECTOR_SIZE;
+    }
+#endif
+    while (n + sizeof(size_t) <= nMax) {
+        size_t const diff = MEM_readST(ip+n) ^ MEM_readST(ref+n);
+        if (diff) return n + MMC_nbCommonBytes(diff);
+        n += sizeof(size_t);
+    }
+    while ((n<nMax) && (ip[n] == ref[n])) n++;
+    return n;
+}
+
+/* MMC_runEnd() : @return : first position within [p, pEnd) which is not c, or pEnd */
+FORCE_INLINE const BYTE* MMC_runEnd(const BYTE* p, const BYTE* const pEnd, BYTE c)
+{
+    size_t const pattern = (size_t)(0x0101010101010101ULL * c);
+    while (p + sizeof(size_t) <= pEnd) {
+        size_t const diff = MEM_readST(p) ^ pattern;
+        if (diff) return p + MMC_nbCommonBytes(diff);
+        p += sizeof(size_t);
+    }
+    while ((p<pEnd) && (*p==c)) p++;
+    return p;
+}
+
+/* MMC_runStart() : @return : lowest position within [pStart, p) such that [position, p) only contains c */
+FORCE_INLINE const BYTE* MMC_runStart(const BYTE* p, const BYTE* const pStart, BYTE c)
+{
+    size_t const pattern = (size_t)(0x0101010101010101ULL * c);
+    while (p >= pStart + sizeof(size_t)) {
+        size_t const diff = MEM_readST(p - sizeof(size_t)) ^ pattern;
+        if (diff) return p - MMC_nbCommonBytesBackward(diff);
+        p -= sizeof(size_t);
+    }
+    while ((p>pStart) && (p[-1]==c)) p--;
+    return p;
+}
+
+#if MMC_INDEX_MODE
+
+/* positions below dictLimit belong to previous buffer, which is virtually followed by current buffer */
+
+FORCE_INLINE U64 MMC_readRefSequence(U32 ref, const BYTE* base, const BYTE* dictBase, U32 dictLimit, U32 mls)
+{
+    if (ref >= dictLimit) return MMC_readSequence(base + ref, mls);
+    if (ref + MMC_READSIZE(mls) <= dictLimit) return MMC_readSequence(dictBase + ref, mls);
+    {   /* sequence straddles both buffers */
+        BYTE sequence[8];
+        U32 u;
+        for (u=0; u<MMC_READSIZE(mls); u++) sequence[u] = *PTR(ref+u);
+        return MMC_readSequence(sequence, mls);
+    }
+}
+
+FORCE_INLINE U32 MMC_countRef(const BYTE* ip, U32 ref, U32 n, U32 nMax, const BYTE* base, const BYTE* dictBase, U32 dictLimit)
+{
+    if (ref < dictLimit) {
+        U32 const dictMax = MIN(nMax, dictLimit - ref);
+        if (n < dictMax) {
+            n = MMC_count(ip, dictBase + ref, n, dictMax);
+            if (n < dictMax) return n;
+        }
+        /* match continues at beginning of current buffer */
+    }
+    return MMC_count(ip, base + ref, n, nMax);
+}
+
+#  define REF_SEQUENCE(r)         MMC_readRefSequence(r, base, dictBase, dictLimit, mls)
+#  define REF_COUNT(r, n, nMax)   MMC_countRef(ip, r, n, nMax, base, dictBase, dictLimit)
+#else
+#  define REF_SEQUENCE(r)         MMC_readSequence(r, mls)
+#  define REF_COUNT(r, n, nMax)   MMC_count(ip, r, n, nMax)
+#endif
+
+/* store an improving candidate; when the list is full, its last slot keeps the best one */
+FORCE_INLINE void MMC_addMatch(MMC_match_t* matches, size_t nbMatchesMax, size_t* nbMatches, size_t length, size_t offset)
+{
+    size_t const n = *nbMatches - (*nbMatches == nbMatchesMax);
+    if (nbMatchesMax == 0) return;
+    matches[n].length = (unsigned)length;
+    matches[n].offset = (unsigned)offset;
+    *nbMatches = n+1;
+}
+
+#define ADD_MATCH(l, r) { if (matches) MMC_addMatch(matches, nbMatchesMax, nbMatches, (l), (size_t)(ipPos - (r))); }
+
+FORCE_INLINE size_t MMC_insert_once_generic (MMC_ctx* MMC, const void* ptr, size_t max, U32 const mls);
+
+/* MMC_insertAndFindBestMatch_generic() :
+ * when matches!=NULL, each improving candidate is also appended into matches[] */
+FORCE_INLINE size_t
+MMC_insertAndFindBestMatch_generic (MMC_ctx* MMC, const void* inputPointer, size_t maxLength, const void** matchpos,
+                                    MMC_match_t* const matches, size_t const nbMatchesMax, size_t* const nbMatches,
+                                    U32 const mls)
 {
     segmentTracker_t* const Segments = MMC->segments;
     selectNextHop_t* const chainTable = MMC->chainTable;
-    const BYTE** const HashTable = MMC->hashTable;
-    const BYTE** const levelList = MMC->levelList;
-    const BYTE*** const trackPtr = MMC->trackPtr;
-    U16* const trackStep = MMC->trackStep;
-    const BYTE* const iend = (const BYTE*)inputPointer + maxLength;
+    hashBucket_t* const HashTable = MMC->hashTable;
+    MMC_pos_t* const LongHashTable = MMC->longHashTable;
+    MMC_pos_t* const levelList = MMC->levelList;
+    MMC_pos_t** const trackPtr = MMC->trackPtr;
+    U32* const trackStep = MMC->trackStep;
+    const BYTE* const base = MMC->base;
+    const BYTE* const dictBase = MMC->dictBase;
+    U32 const dictLimit = MMC->dictLimit;
+    size_t const chainMask = ((size_t)1 << MMC->windowLog) - 1;
+    U32 const levelMask = (1U << LEVELLOG(MMC->windowLog)) - 1;
+    U32 const hashLog = MMC->hashLog;
+    U32 const maxDistance = MMC->maxDistance;
     const BYTE* const ip = (const BYTE*)inputPointer;
-    const BYTE*  ref;
-    const BYTE** gateway;
-    U16 stepNb=0;
-    U32 currentLevel, maxLevel;
+    const BYTE* iend = ip + maxLength;
+    MMC_pos_t const ipPos = POS(ip);
+#if MMC_INDEX_MODE
+    MMC_pos_t const lowestPos = MAX(ipPos - maxDistance, MMC->lowLimit - 1);   /* excluded */
+#else
+    MMC_pos_t const lowestPos = ip - maxDistance;
+#endif
+    MMC_pos_t  ref;
+    MMC_pos_t* gateway;
+    U32 stepNb = MMC->stepNb;   /* steps of previous searches are lower : trackStep needs no reset */
+    U32 currentLevel, maxLevel=0, levelFloor;
     U32 ml=0, mlt=0, nbChars=0;
-    U32 sequence;
-
-    if (maxLength < 4) return 0;  /* no solution */
-    sequence = MEM_read32(ip);
+    U32 attempts = MMC->maxAttempts;
+#if MMC_GUARD
+    U32 attemptsMax;
+#endif
+    U32 niceLength = MMC->niceLength;
+    size_t compared = 0;
+    U64 sequence;
+
+    (void)base; (void)dictBase; (void)dictLimit;   /* unused when MMC_INDEX_MODE==0 */
+    (void)LongHashTable;   /* unused when MMC_LONG_HASH==0 */
+    if (iend > MMC->nextSrc) MMC->nextSrc = iend;
+#if MMC_GUARD
+    MMC->workAvg -= MMC->workAvg >> MMC_GUARD_SPANLOG;
+    if (MMC->shallow) {
+        if (MMC->workAvg < (MMC_GUARD_BUDGET << MMC_GUARD_SPANLOG) / 2) MMC->shallow = 0;
+    } else {
+        if (MMC->workAvg > (MMC_GUARD_BUDGET << MMC_GUARD_SPANLOG)) MMC->shallow = 1;
+    }
+    if (MMC->shallow) {
+        if (maxLength > 16*MMC_GUARD_NICE) { maxLength = 16*MMC_GUARD_NICE; iend = ip + maxLength; }
+        attempts = MIN(attempts, MMC_GUARD_ATTEMPTS);
+        niceLength = MIN(niceLength, MMC_GUARD_NICE);
+    }
+    attemptsMax = attempts;
+#endif
+    if (maxLength < MMC_READSIZE(mls)) return 0;  /* no solution */
+    sequence = MMC_readSequence(ip, mls);
+    PREFETCH_AHEAD(ip, iend);
 
     // RLE match finder (special case)
-    if ( (U16)sequence == (U16)(sequence>>16)
-      && (BYTE)sequence == (BYTE)(sequence>>8) ) {
-        BYTE const c = (BYTE)sequence;
+    if (sequence == MMC_rleSequence(*ip, mls)) {
+        BYTE const c = *ip;
         U32 index = Segments[c].start;
-        const BYTE* endSegment = ip+MINMATCH;
+        const BYTE* endSegment = ip+mls;
 
-        while ((*endSegment==c) && (endSegment<iend)) endSegment++;
+        STATS_ADD(rleHits, 1);
+        endSegment = MMC_runEnd(endSegment, iend, c);
         nbChars = endSegment-ip;
+        compared = nbChars;
 
         while (Segments[c].segments[index].size < nbChars) index--;
 
-        if ((Segments[c].segments[index].position - nbChars) <= (ip - MAX_DISTANCE))      // no large enough previous serie within range
+        if (Segments[c].segments[index].position <= lowestPos + nbChars)      // no large enough previous serie within range
         {
             // no "previous" segment within range
-            NEXT_TRY(ip) = LEVEL_UP(ip) = 0;
-            if (nbChars==MINMATCH) MMC_insert_once(MMC, ip, iend-ip);
+            NEXT_TRY(ipPos) = LEVEL_UP(ipPos) = 0;
+            if (nbChars==mls) MMC_insert_once_generic(MMC, ip, (iend-ip) - mls, mls);   /* insertion reads up to mls bytes beyond its range */
             if ((ip>MMC->beginBuffer) && (*(ip-1)==c)) {
                 // obvious RLE solution
                 *matchpos= ip-1;
-                return nbChars;
+                ADD_MATCH(nbChars, ipPos-1);
+                ml = nbChars;
+                goto _endSearch;
             }
             return 0;
         }
 
-        ref = NEXT_TRY(ip)= Segments[c].segments[index].position - nbChars;
-        currentLevel = maxLevel = ml = nbChars;
-        LEVEL(currentLevel) = ip;
+        ref = NEXT_TRY(ipPos)= Segments[c].segments[index].position - nbChars;
+        currentLevel = maxLevel = levelFloor = ml = nbChars;
+        LEVEL(currentLevel) = ipPos;
         gateway = 0; // work around due to erasing
-        LEVEL_UP(ip) = 0;
-        if (*(ip-1)==c) *matchpos = ip-1; else *matchpos = ref;     // "basis" to be improved upon
-        if (nbChars==MINMATCH) {
-            MMC_insert_once(MMC, ip, iend-ip);
-            gateway = &LEVEL_UP(ip);
+        LEVEL_UP(ipPos) = 0;
+        if ((ip>MMC->beginBuffer) && (*(ip-1)==c)) {     // "basis" to be improved upon
+            *matchpos = ip-1;
+            ADD_MATCH(ml, ipPos-1);
+        } else {
+            *matchpos = PTR(ref);
+            ADD_MATCH(ml, ref);
+        }
+        if (nbChars==mls) {
+            MMC_insert_once_generic(MMC, ip, (iend-ip) - mls, mls);
+            gateway = &LEVEL_UP(ipPos);
         }
         goto _FindBetterMatch;
     }
 
     // MMC match finder
-    ref = HashTable[MMC_hash(sequence)];
-    ADD_HASH(ip);
-    if (!ref) return 0;
-    gateway = &LEVEL_UP(ip);
-    currentLevel = maxLevel = MINMATCH-1;
-    LEVEL(MINMATCH-1) = ip;
+    {   U32 const h = MMC_hash(sequence, hashLog, mls);
+#if MMC_HASH_TAGS
+        int const absent = !(HashTable[h].tags & (0x10001U << MMC_hashTag(sequence, hashLog, mls)));
+#endif
+        ref = HEAD(h);
+        ADD_HASH(ip);
+        STATS_ADD(hashLookups, 1);
+#if MMC_LONG_HASH
+        if ((mls < LONG_LENGTH) && (maxLength >= LONG_LENGTH)) {
+            U32 const lh = LONG_HASH_VALUE(ip);
+            MMC_pos_t const longRef = LongHashTable[lh];
+            LongHashTable[lh] = ipPos;
+            if ((nbMatchesMax <= 1) && (longRef > lowestPos)) {
+                /* the match to beat; only when keeping the best match, since a list of matches also needs shorter ones */
+                U32 const longLength = (U32)REF_COUNT(longRef, 0, (U32)maxLength);
+                compared += longLength;
+                if (longLength >= LONG_LENGTH) {
+                    STATS_ADD(longHashHits, 1);
+                    ml = longLength;
+                    *matchpos = PTR(longRef);
+                    ADD_MATCH(ml, longRef);
+        }   }   }
+#endif
+        if (!ref) return 0;
+#if MMC_HASH_TAGS
+        if (absent) return 0;   /* only hash collisions within window */
+#endif
+    }
+    gateway = &LEVEL_UP(ipPos);
+    currentLevel = maxLevel = levelFloor = mls-1;
+    LEVEL(mls-1) = ipPos;
 
     // Collision detection & avoidance
-    while ((ref) && ((ip-ref) < MAX_DISTANCE)) {
-        if (MEM_read32(ref) != sequence) {
-            LEVEL(MINMATCH-1) = ref;
+    while (ref > lowestPos) {
+        if ((ml >= niceLength) || (attempts == 0) || (maxLevel - levelFloor >= levelMask)) goto _stopSearch;
+        attempts--;
+        STATS_ADD(chainHops, 1);
+        PREFETCH_REF(NEXT_TRY(ref));
+        if (REF_SEQUENCE(ref) != sequence) {
+            STATS_ADD(collisions, 1);
+            LEVEL(mls-1) = ref;
             ref = NEXT_TRY(ref);
             continue;
         }
 
-        mlt = MINMATCH;
-        while ((mlt<(U32)maxLength) && (*(ip+mlt)) == *(ref+mlt)) mlt++;
+        mlt = REF_COUNT(ref, mls, (U32)maxLength);
+        compared += mlt - mls;
+        STATS_ADD(promotions, 1);
 
         if (mlt > ml) {
             ml = mlt;
-            *matchpos = ref;
+            *matchpos = PTR(ref);
+            ADD_MATCH(ml, ref);
         }
 
         // Continue level mlt chain
@@ -274,13 +1119,13 @@ size_t MMC_insertAndFindBestMatch (MMC_ctx* MMC, const void* inputPointer, size_
             }
         }
 
-        {   const BYTE* currentP = ref;
-            NEXT_TRY(LEVEL(MINMATCH-1)) = NEXT_TRY(ref);      // Extraction from base level
+        {   MMC_pos_t currentP = ref;
+            NEXT_TRY(LEVEL(mls-1)) = NEXT_TRY(ref);           // Extraction from base level
             if (LEVEL_UP(ref)) {
                 ref = LEVEL_UP(ref);
                 NEXT_TRY(currentP) = LEVEL_UP(currentP) = 0;  // Clean, because extracted
                 currentLevel++;
-                NEXT_TRY(LEVEL(MINMATCH)) = ref;
+                NEXT_TRY(LEVEL(mls)) = ref;
                 break;
             }
             ref = NEXT_TRY(ref);
@@ -292,24 +1137,28 @@ size_t MMC_insertAndFindBestMatch (MMC_ctx* MMC, const void* inputPointer, size_
 
     // looking for better length of match
 _FindBetterMatch:
-    while ((ref) && ((ip-ref) < MAX_DISTANCE)) {
-        // Reset rolling counter for Secondary Promotions
-        if (!stepNb) {
-            U32 i;
-            for (i=0; i<NBCHARACTERS; i++) trackStep[i]=0;
-            stepNb=1;
-        }
+    if (stepNb > STEPNB_MAX) {
+        MEM_INIT(trackStep, 0, sizeof(MMC->trackStep));
+        stepNb = 1;
+    }
+    while (ref > lowestPos) {
+        if ((ml >= niceLength) || (attempts == 0) || (maxLevel - levelFloor >= levelMask)) goto _stopSearch;
+        attempts--;
+        STATS_ADD(chainHops, 1);
+        PREFETCH_REF(NEXT_TRY(ref));
+        PREFETCH_REF(LEVEL_UP(ref));
 
         // Match Count
-        mlt = currentLevel;
-        while ((mlt<(U32)maxLength) && (*(ip+mlt)) == *(ref+mlt)) mlt++;
+        mlt = REF_COUNT(ref, currentLevel, (U32)maxLength);
+        compared += mlt - currentLevel;
 
         // First case : No improvement => continue on current chain
         if (mlt==currentLevel) {
-            BYTE c = *(ref+currentLevel);
+            BYTE c = *PTR(ref+currentLevel);
             if (trackStep[c] == stepNb) {
                 // this wrong character was already met before
-                const BYTE* next = NEXT_TRY(ref);
+                MMC_pos_t next = NEXT_TRY(ref);
+                STATS_ADD(promotions, 1);
                 *trackPtr[c] = ref;                               // linking
                 NEXT_TRY(LEVEL(currentLevel)) = NEXT_TRY(ref);    // extraction
                 if (LEVEL_UP(ref)) {
@@ -324,6 +1173,7 @@ _FindBetterMatch:
                 if (next==LEVEL_DOWN) {
                     NEXT_TRY(LEVEL(currentLevel)) = 0;                // Erase the LEVEL_DOWN
                     currentLevel--; stepNb++;
+                    STATS_ADD(levelDowns, 1);
                     next = NEXT_TRY(LEVEL(currentLevel));
                     while (next > ref) { LEVEL(currentLevel) = next; next = NEXT_TRY(next); }
                 }
@@ -347,27 +1197,30 @@ _continue_same_level:
             LEVEL(currentLevel) = ref;
             ref = NEXT_TRY(ref);
             if (ref == LEVEL_DOWN) {
-                const BYTE* localCurrentP = LEVEL(currentLevel);
-                const BYTE* next = NEXT_TRY(LEVEL(currentLevel-1));
+                MMC_pos_t localCurrentP = LEVEL(currentLevel);
+                MMC_pos_t next = NEXT_TRY(LEVEL(currentLevel-1));
                 NEXT_TRY(localCurrentP) = 0;                            // Erase the LEVEL_DOWN
                 while (next>localCurrentP) { LEVEL(currentLevel-1) = next; next = NEXT_TRY(next);}
                 ref = next;
                 currentLevel--; stepNb++;
+                STATS_ADD(levelDowns, 1);
             }
             continue;
         }
 
         // Now, mlt > currentLevel
+        STATS_ADD(promotions, 1);
         if (mlt>ml) {
             ml = mlt;
-            *matchpos = ref;
+            *matchpos = PTR(ref);
+            ADD_MATCH(ml, ref);
         }
 
         // placing into corresponding chain
         if (mlt<=maxLevel) {
             NEXT_TRY(LEVEL(mlt)) = ref; LEVEL(mlt) = ref;        // Completing chain at Level mlt
 _check_mmc_levelup:
-            {   const BYTE* currentP = ref;
+            {   MMC_pos_t currentP = ref;
                 NEXT_TRY(LEVEL(currentLevel)) = NEXT_TRY(ref);    // Extraction from base level
                 if (LEVEL_UP(ref)) {
                     ref = LEVEL_UP(ref);                          // LevelUp
@@ -378,11 +1231,12 @@ _check_mmc_levelup:
                     ref = NEXT_TRY(ref);
                     NEXT_TRY(currentP) = 0;                       // promotion to level mlt; note that LEVEL_UP(ref)=0;
                     if (ref == LEVEL_DOWN) {
-                        const BYTE* next = NEXT_TRY(LEVEL(currentLevel-1));
+                        MMC_pos_t next = NEXT_TRY(LEVEL(currentLevel-1));
                         NEXT_TRY(LEVEL(currentLevel)) = 0;        // Erase the LEVEL_DOWN (which has been transfered)
                         while (next>currentP) { LEVEL(currentLevel-1) = next; next = NEXT_TRY(next); }
                         ref = next;
                         currentLevel--; stepNb++;
+                        STATS_ADD(levelDowns, 1);
                     }
                 }
                 continue;
@@ -418,8 +1272,30 @@ _check_mmc_levelup:
         goto _check_mmc_levelup;
     }
 
-    if (gateway) *gateway=ip-MAX_DISTANCE-1;    // early end trick
-    stepNb++;
+    if (gateway) *gateway=lowestPos;    // early end trick
+    goto _endSearch;
+
+_stopSearch:
+    /* Search stopped before the end of chain : chains are valid at this point, but levels above current one
+     * are incomplete. Their remaining candidates are still in lower levels : link them back down.
+     * Except into base level (mls-1) : its candidates only share a hash, not a verified prefix,
+     * so level mls just ends; its missing candidates remain reachable from the hash chain. */
+    {   U32 l;
+        for (l=MAX(currentLevel, mls)+1; l<=maxLevel; l++)
+            if (NEXT_TRY(LEVEL(l)) == 0) NEXT_TRY(LEVEL(l)) = LEVEL_DOWN;
+    }
+
+_endSearch:
+    MMC->stepNb = stepNb + 1;
+    STATS_MAX(maxLevel, maxLevel);
+#if MMC_GUARD
+    {   /* in shallow mode, reaching a limit means input is still pathological */
+        U32 const work = (MMC->shallow && ((attempts == 0) || (ml >= niceLength))) ?
+                         2 * MMC_GUARD_BUDGET :
+                         (U32)MIN((attemptsMax - attempts) + (compared >> 4), MMC_GUARD_BUDGET << MMC_GUARD_SPANLOG);
+        MMC->workAvg += work;
+    }
+#endif
 
     // prevent match beyond buffer
     if ((ip+ml)>iend) ml = iend-ip;
@@ -428,76 +1304,557 @@ _check_mmc_levelup:
 }
 
 
-static size_t MMC_insert_once (MMC_ctx* MMC, const void* ptr, size_t max)
+FORCE_INLINE size_t MMC_insert_once_generic (MMC_ctx* MMC, const void* ptr, size_t max, U32 const mls)
 {
     segmentTracker_t * Segments = MMC->segments;
     selectNextHop_t * chainTable = MMC->chainTable;
-    const BYTE** HashTable = MMC->hashTable;
+    hashBucket_t* HashTable = MMC->hashTable;
+    MMC_pos_t* LongHashTable = MMC->longHashTable;
     const BYTE* ip = (const BYTE*)ptr;
     const BYTE* iend = ip+max;
     const BYTE* beginBuffer = MMC->beginBuffer;
+    const BYTE* const base = MMC->base;
+    size_t const chainMask = ((size_t)1 << MMC->windowLog) - 1;
+    U32 const hashLog = MMC->hashLog;
+    U32 const maxDistance = MMC->maxDistance;
+#if MMC_INDEX_MODE
+    MMC_pos_t const lowestPos = MAX(POS(ip) - maxDistance, MMC->lowLimit - 1);   /* excluded */
+#else
+    MMC_pos_t const lowestPos = ip - maxDistance;
+#endif
+
+    (void)base;   /* unused when MMC_INDEX_MODE==0 */
+    (void)LongHashTable;   /* unused when MMC_LONG_HASH==0 */
 
     /* RLE updater */
-    if ( (MEM_read16(ip) == MEM_read16(ip+2))
-      && (*ip == *(ip+1)) )   /* 4 identical bytes */
+    if (MMC_readSequence(ip, mls) == MMC_rleSequence(*ip, mls))   /* mls identical bytes */
     {
         BYTE const c = *ip;
-        U32 nbForwardChars, nbPreviousChars, segmentSize, n=MINMATCH;
-        const BYTE* endSegment = ip+MINMATCH;
+        U32 nbForwardChars, nbPreviousChars, segmentSize, n=mls;
+        const BYTE* endSegment = ip+mls;
         const BYTE* baseStreamP = ip;
 
-        iend += MINMATCH;
-        while ((*endSegment==c) && (endSegment<iend)) endSegment++;
+        iend += mls;
+        endSegment = MMC_runEnd(endSegment, iend, c);
         if (endSegment == iend) return (iend-ip);     /* skip the whole forward segment; we'll start again later */
         nbForwardChars = endSegment-ip;
-        while ((baseStreamP>beginBuffer) && (baseStreamP[-1]==c)) baseStreamP--;
+        baseStreamP = MMC_runStart(baseStreamP, beginBuffer, c);
         nbPreviousChars = ip-baseStreamP;
         segmentSize = nbForwardChars + nbPreviousChars;
-        if (segmentSize > MAX_DISTANCE-1) segmentSize = MAX_DISTANCE-1;
+        if (segmentSize > maxDistance-1) segmentSize = maxDistance-1;
 
         while (Segments[c].segments[Segments[c].start].size <= segmentSize) {
-            if (Segments[c].segments[Segments[c].start].position <= (ip-MAX_DISTANCE)) break;
+            if (Segments[c].segments[Segments[c].start].position <= lowestPos) break;
             for ( ; n<=Segments[c].segments[Segments[c].start].size ; n++) {
-                NEXT_TRY(endSegment-n) = Segments[c].segments[Segments[c].start].position - n;
-                LEVEL_UP(endSegment-n) = 0;
+                NEXT_TRY(POS(endSegment-n)) = Segments[c].segments[Segments[c].start].position - n;
+                LEVEL_UP(POS(endSegment-n)) = 0;
             }
             Segments[c].start--;
         }
 
-        if (Segments[c].segments[Segments[c].start].position <= (ip-MAX_DISTANCE))
+        if (Segments[c].segments[Segments[c].start].position <= lowestPos)
             Segments[c].start = 0;   /* no large enough serie within range */
 
         for ( ; n<=segmentSize ; n++) {
-            NEXT_TRY(endSegment-n) = Segments[c].segments[Segments[c].start].position - n;
-            LEVEL_UP(endSegment-n) = 0;
+            NEXT_TRY(POS(endSegment-n)) = Segments[c].segments[Segments[c].start].position - n;
+            LEVEL_UP(POS(endSegment-n)) = 0;
         }
 
-        /* overflow protection : new segment smaller than previous, but too many segments in memory */
-        if (Segments[c].start > Segments[c].max-2) {
-            segmentInfo_t* newSegment = REALLOCATOR (Segments[c].segments, (Segments[c].max * 2) * sizeof(segmentInfo_t));
-            U32 beginning=0;
-
-            if (newSegment == NULL) return 0;  /* allocation failed : we stop search here. Ideally, it should be an error, rather than a soft "end of search" */
-            Segments[c].max *= 2;
-            Segments[c].segments = newSegment;
-            /* transfer still valid positions (within window size) towards beginning of buffer */
-            while (newSegment[beginning].position < (ip-MAX_DISTANCE)) beginning++;
-            {   U32 u; for (u = beginning; u <= Segments[c].start; u++) {
-                    newSegment[u - (beginning-1)] = newSegment[u];
-            }   }
-            Segments[c].start -= (beginning-1);
+        /* list full : new segment smaller than previous, but too many segments in memory.
+         * Some are beyond window, since capacity exceeds what the window can hold (see MMC_segmentsMax()) */
+        if (Segments[c].start > MMC->segmentsMax-2) {
+            segmentInfo_t* const segments = Segments[c].segments;
+            U32 first = 1;   /* oldest segment still within window */
+
+            STATS_ADD(segmentOverflows, 1);
+            while (segments[first].position <= lowestPos) first++;
+            /* transfer still valid positions towards beginning of list */
+            memmove(segments+1, segments+first, (Segments[c].start-first+1) * sizeof(segmentInfo_t));
+            Segments[c].start -= first-1;
         }
         Segments[c].start++;
-        Segments[c].segments[Segments[c].start].position = endSegment;
+        Segments[c].segments[Segments[c].start].position = POS(endSegment);
         Segments[c].segments[Segments[c].start].size = segmentSize;
 
-        return (endSegment-ip-(MINMATCH-1));
+        return (endSegment-ip-(mls-1));
     }
 
     /* Normal update */
-    NEXT_TRY(ip) = HashTable[HASH_VALUE(ip)];
-    LEVEL_UP(ip) = 0;
-    HashTable[HASH_VALUE(ip)] = ip;
+    PREFETCH_AHEAD(ip, iend);
+    ADD_HASH(ip);
+#if MMC_LONG_HASH
+    if ((mls < LONG_LENGTH) && (ip + LONG_LENGTH <= iend)) LongHashTable[LONG_HASH_VALUE(ip)] = POS(ip);
+#endif
 
     return 1;
 }
+
+
+FORCE_INLINE size_t MMC_insertRange_generic (MMC_ctx* MMC, const BYTE* ip, const BYTE* const iend, U32 const mls)
+{
+    while (ip < iend) {
+        MMC_checkIndex(MMC, ip);
+        ip += MMC_insert_once_generic(MMC, ip, iend-ip, mls);   /* skips whole RLE segments */
+    }
+    return 0;
+}
+
+/* search ip, and provide the offset of the best match, 0 if none */
+FORCE_INLINE size_t MMC_findBestOffset_generic (MMC_ctx* MMC, const BYTE* ip, size_t maxLength, unsigned* offsetPtr, U32 const mls)
+{
+    const void* matchpos;
+    MMC_match_t best;
+    size_t nbMatches = 0;
+    size_t const ml = MMC_insertAndFindBestMatch_generic(MMC, ip, maxLength, &matchpos, &best, 1, &nbMatches, mls);
+    *offsetPtr = ml ? best.offset : 0;   /* counted in indexes, so valid across buffers */
+    return ml;
+}
+
+FORCE_INLINE size_t
+MMC_findMatchesBatch_generic (MMC_ctx* MMC, const BYTE* const src, size_t srcSize, unsigned* lengths, unsigned* offsets, U32 const mls)
+{
+    size_t n, nbFound = 0;
+    for (n=0; n<srcSize; n++) {
+        size_t ml;
+        MMC_checkIndex(MMC, src+n);
+        ml = MMC_findBestOffset_generic(MMC, src+n, srcSize-n, offsets+n, mls);
+        lengths[n] = (unsigned)ml;
+        nbFound += (ml > 0);
+    }
+    return nbFound;
+}
+
+/* MMC_prefetchSearch_generic() :
+ * stage 0 : prefetch hash bucket of ip.
+ * stage 1 : read it, and prefetch chain slot and data of first candidate, so that stage 0 must have been issued earlier. */
+FORCE_INLINE void MMC_prefetchSearch_generic (const MMC_ctx* MMC, const BYTE* ip, size_t maxLength, int stage, U32 const mls)
+{
+    const hashBucket_t* const HashTable = MMC->hashTable;
+    const selectNextHop_t* const chainTable = MMC->chainTable;
+    const BYTE* const base = MMC->base;
+    const BYTE* const dictBase = MMC->dictBase;
+    U32 const dictLimit = MMC->dictLimit;
+    size_t const chainMask = ((size_t)1 << MMC->windowLog) - 1;
+    U32 const hashLog = MMC->hashLog;
+
+    (void)base; (void)dictBase; (void)dictLimit; (void)chainTable; (void)chainMask;   /* unused when MMC_INDEX_MODE==0 or MMC_PREFETCH==0 */
+    if (maxLength < MMC_READSIZE(mls)) return;
+    if (stage == 0) {
+        PREFETCH(HashTable + HASH_VALUE(ip));
+    } else {
+        MMC_pos_t const ref = HEAD(HASH_VALUE(ip));
+        if (ref) PREFETCH_REF(ref);
+    }
+}
+
+FORCE_INLINE void MMC_prefetchSearch (const MMC_ctx* MMC, const BYTE* ip, size_t maxLength, int stage)
+{
+    switch(MMC->minMatch)
+    {
+    case 3 : MMC_prefetchSearch_generic(MMC, ip, maxLength, stage, 3); break;
+    default:
+    case 4 : MMC_prefetchSearch_generic(MMC, ip, maxLength, stage, 4); break;
+    case 5 : MMC_prefetchSearch_generic(MMC, ip, maxLength, stage, 5); break;
+    case 6 : MMC_prefetchSearch_generic(MMC, ip, maxLength, stage, 6); break;
+    case 7 : MMC_prefetchSearch_generic(MMC, ip, maxLength, stage, 7); break;
+    case 8 : MMC_prefetchSearch_generic(MMC, ip, maxLength, stage, 8); break;
+    }
+}
+
+
+size_t MMC_insertAndFindBestMatch (MMC_ctx* MMC, const void* inputPointer, size_t maxLength, const void** matchpos)
+{
+    MMC_checkIndex(MMC, (const BYTE*)inputPointer);
+    switch(MMC->minMatch)
+    {
+    case 3 : return MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, matchpos, NULL, 0, NULL, 3);
+    default:
+    case 4 : return MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, matchpos, NULL, 0, NULL, 4);
+    case 5 : return MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, matchpos, NULL, 0, NULL, 5);
+    case 6 : return MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, matchpos, NULL, 0, NULL, 6);
+    case 7 : return MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, matchpos, NULL, 0, NULL, 7);
+    case 8 : return MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, matchpos, NULL, 0, NULL, 8);
+    }
+}
+
+size_t MMC_insertAndFindAllMatches (MMC_ctx* MMC, const void* inputPointer, size_t maxLength,
+                                    MMC_match_t* matches, size_t nbMatchesMax)
+{
+    const void* matchpos;
+    size_t nbMatches = 0;
+    MMC_checkIndex(MMC, (const BYTE*)inputPointer);
+    switch(MMC->minMatch)
+    {
+    case 3 : MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, &matchpos, matches, nbMatchesMax, &nbMatches, 3); break;
+    default:
+    case 4 : MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, &matchpos, matches, nbMatchesMax, &nbMatches, 4); break;
+    case 5 : MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, &matchpos, matches, nbMatchesMax, &nbMatches, 5); break;
+    case 6 : MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, &matchpos, matches, nbMatchesMax, &nbMatches, 6); break;
+    case 7 : MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, &matchpos, matches, nbMatchesMax, &nbMatches, 7); break;
+    case 8 : MMC_insertAndFindBestMatch_generic(MMC, inputPointer, maxLength, &matchpos, matches, nbMatchesMax, &nbMatches, 8); break;
+    }
+    return nbMatches;
+}
+
+size_t MMC_findMatchesBatch (MMC_ctx* MMC, const void* src, size_t srcSize, unsigned* lengths, unsigned* offsets)
+{
+    const BYTE* const ip = (const BYTE*)src;
+    switch(MMC->minMatch)
+    {
+    case 3 : return MMC_findMatchesBatch_generic(MMC, ip, srcSize, lengths, offsets, 3);
+    default:
+    case 4 : return MMC_findMatchesBatch_generic(MMC, ip, srcSize, lengths, offsets, 4);
+    case 5 : return MMC_findMatchesBatch_generic(MMC, ip, srcSize, lengths, offsets, 5);
+    case 6 : return MMC_findMatchesBatch_generic(MMC, ip, srcSize, lengths, offsets, 6);
+    case 7 : return MMC_findMatchesBatch_generic(MMC, ip, srcSize, lengths, offsets, 7);
+    case 8 : return MMC_findMatchesBatch_generic(MMC, ip, srcSize, lengths, offsets, 8);
+    }
+}
+
+/* MMC_findBestOffset() :
+ * not inlined : a single instance per mls is shared by all its callers */
+FORCE_NOINLINE size_t MMC_findBestOffset (MMC_ctx* MMC, const BYTE* ip, size_t maxLength, unsigned* offsetPtr)
+{
+    MMC_checkIndex(MMC, ip);
+    switch(MMC->minMatch)
+    {
+    case 3 : return MMC_findBestOffset_generic(MMC, ip, maxLength, offsetPtr, 3);
+    default:
+    case 4 : return MMC_findBestOffset_generic(MMC, ip, maxLength, offsetPtr, 4);
+    case 5 : return MMC_findBestOffset_generic(MMC, ip, maxLength, offsetPtr, 5);
+    case 6 : return MMC_findBestOffset_generic(MMC, ip, maxLength, offsetPtr, 6);
+    case 7 : return MMC_findBestOffset_generic(MMC, ip, maxLength, offsetPtr, 7);
+    case 8 : return MMC_findBestOffset_generic(MMC, ip, maxLength, offsetPtr, 8);
+    }
+}
+
+size_t MMC_findMatchesInterleaved (MMC_stream_t* streams, size_t nbStreams)
+{
+    size_t maxSize = 0, nbFound = 0, pos, s;
+    for (s=0; s<nbStreams; s++) maxSize = MAX(maxSize, streams[s].srcSize);
+
+    /* one position of each stream per round : memory accesses of all streams are issued before any is waited upon */
+    for (pos=0; pos<maxSize; pos++) {
+        int stage;
+        for (stage=0; stage<2; stage++) {
+            for (s=0; s<nbStreams; s++) {
+                const MMC_stream_t* const stream = streams + s;
+                if (pos < stream->srcSize)
+                    MMC_prefetchSearch(stream->ctx, (const BYTE*)stream->src + pos, stream->srcSize - pos, stage);
+        }   }
+        for (s=0; s<nbStreams; s++) {
+            const MMC_stream_t* const stream = streams + s;
+            if (pos < stream->srcSize) {
+                size_t const ml = MMC_findBestOffset(stream->ctx, (const BYTE*)stream->src + pos, stream->srcSize - pos, stream->offsets + pos);
+                stream->lengths[pos] = (unsigned)ml;
+                nbFound += (ml > 0);
+    }   }   }
+    return nbFound;
+}
+
+size_t MMC_insertRange (MMC_ctx* MMC, const void* from, const void* to)
+{
+    const BYTE* const ip = (const BYTE*)from;
+    const BYTE* const iend = (const BYTE*)to;
+    if (iend > MMC->nextSrc) MMC->nextSrc = iend;
+    switch(MMC->minMatch)
+    {
+    case 3 : return MMC_insertRange_generic(MMC, ip, iend, 3);
+    default:
+    case 4 : return MMC_insertRange_generic(MMC, ip, iend, 4);
+    case 5 : return MMC_insertRange_generic(MMC, ip, iend, 5);
+    case 6 : return MMC_insertRange_generic(MMC, ip, iend, 6);
+    case 7 : return MMC_insertRange_generic(MMC, ip, iend, 7);
+    case 8 : return MMC_insertRange_generic(MMC, ip, iend, 8);
+    }
+}
+
+
+/* *******************************************************************
+*  Parsing
+*********************************************************************/
+FORCE_INLINE U32 MMC_highbit(U32 v)   /* v must be != 0 */
+{
+    return (U32)(sizeof(size_t)*8 - 1 - MMC_clz((size_t)v));
+}
+
+/* search ip, and provide the offset of the best match.
+ * parser searches from several places : they share MMC_findBestOffset() instead of inlining the search */
+FORCE_INLINE size_t MMC_search_generic(MMC_ctx* MMC, const BYTE* ip, const BYTE* iend, U32* offsetPtr, U32 const mls)
+{
+    unsigned offset;
+    size_t const ml = MMC_findBestOffset(MMC, ip, (size_t)(iend-ip), &offset);
+    if (ml < mls) return 0;
+    *offsetPtr = offset;
+    return ml;
+}
+
+FORCE_INLINE size_t
+MMC_parse_generic(MMC_ctx* MMC, const BYTE* const src, size_t srcSize, U32 const depth, MMC_sequence_t* seqOut, U32 const mls)
+{
+    const BYTE* const iend = src + srcSize;
+    const BYTE* const ilimit = srcSize >= MMC_READSIZE(mls) ? iend - MMC_READSIZE(mls) : src;   /* last position searched, and limit of insertion */
+    const BYTE* ip = src;
+    const BYTE* anchor = src;
+    const BYTE* nextToInsert = src;   /* positions before it are already inserted */
+    MMC_sequence_t* seq = seqOut;
+    const BYTE* base;
+    const BYTE* dictBase;
+    U32 dictLimit;
+
+    if (MMC_continue(MMC, src, srcSize)) return 0;
+    base = MMC->base; dictBase = MMC->dictBase; dictLimit = MMC->dictLimit;
+    (void)base; (void)dictBase; (void)dictLimit;   /* unused when MMC_INDEX_MODE==0 */
+
+    while (ip <= ilimit) {
+        const BYTE* start = ip;
+        U32 offset = 0;
+        size_t ml = MMC_search_generic(MMC, ip, iend, &offset, mls);
+        nextToInsert = ip+1;
+        if (ml == 0) { ip++; continue; }
+
+        /* lazy evaluation : a match starting later may be better */
+        while ((depth >= 2) && (ip < ilimit)) {
+            U32 offset2 = 0;
+            size_t ml2;
+            ip++;
+            ml2 = MMC_search_generic(MMC, ip, iend, &offset2, mls);
+            nextToInsert = ip+1;
+            if (ml2) {
+                int const gain2 = (int)(ml2*4 - MMC_highbit(offset2));
+                int const gain1 = (int)(ml*4 - MMC_highbit(offset) + 4);
+                if (gain2 > gain1) { ml = ml2; offset = offset2; start = ip; continue; }
+            }
+            if ((depth == 3) && (ip < ilimit)) {
+                ip++;
+                ml2 = MMC_search_generic(MMC, ip, iend, &offset2, mls);
+                nextToInsert = ip+1;
+                if (ml2) {
+                    int const gain2 = (int)(ml2*4 - MMC_highbit(offset2));
+                    int const gain1 = (int)(ml*4 - MMC_highbit(offset) + 7);
+                    if (gain2 > gain1) { ml = ml2; offset = offset2; start = ip; continue; }
+                }
+            }
+            break;
+        }
+
+        /* extend match backwards over pending literals */
+#if MMC_INDEX_MODE
+        {   U32 refPos = POS(start) - offset;
+            while ((start > anchor) && (refPos > MMC->lowLimit) && (start[-1] == *PTR(refPos-1))) { start--; refPos--; ml++; }
+        }
+#else
+        {   const BYTE* ref = start - offset;
+            while ((start > anchor) && (ref > MMC->beginBuffer) && (start[-1] == ref[-1])) { start--; ref--; ml++; }
+        }
+#endif
+
+        seq->litLength = (unsigned)(start - anchor);
+        seq->matchLength = (unsigned)ml;
+        seq->offset = offset;
+        seq++;
+
+        /* positions covered by the match are inserted, without being searched */
+        ip = anchor = start + ml;
+        if (nextToInsert < MIN(ip, ilimit))
+            MMC_insertRange_generic(MMC, nextToInsert, MIN(ip, ilimit), mls);
+    }
+
+    /* last literals */
+    seq->litLength = (unsigned)(iend - anchor);
+    seq->matchLength = 0;
+    seq->offset = 0;
+    seq++;
+    return (size_t)(seq - seqOut);
+}
+
+size_t MMC_parse(MMC_ctx* MMC, const void* src, size_t srcSize, MMC_strategy strategy, MMC_sequence_t* seqOut)
+{
+    const BYTE* const istart = (const BYTE*)src;
+    U32 const depth = (U32)strategy;
+    if ((depth < MMC_greedy) || (depth > MMC_lazy2)) return 0;
+    switch(MMC->minMatch)
+    {
+    case 3 : return MMC_parse_generic(MMC, istart, srcSize, depth, seqOut, 3);
+    default:
+    case 4 : return MMC_parse_generic(MMC, istart, srcSize, depth, seqOut, 4);
+    case 5 : return MMC_parse_generic(MMC, istart, srcSize, depth, seqOut, 5);
+    case 6 : return MMC_parse_generic(MMC, istart, srcSize, depth, seqOut, 6);
+    case 7 : return MMC_parse_generic(MMC, istart, srcSize, depth, seqOut, 7);
+    case 8 : return MMC_parse_generic(MMC, istart, srcSize, depth, seqOut, 8);
+    }
+}
+
+/* *******************************************************************
+*  Multi-threaded parsing
+*********************************************************************/
+typedef struct {
+    const BYTE* src;
+    size_t srcSize;
+    size_t blockSize;
+    size_t nbBlocks;
+    size_t nextBlock;               /* next block to parse; shared among workers */
+    MMC_strategy strategy;
+    MMC_parameters params;
+    MMC_sequence_t* seqOut;
+    size_t* nbSeqs;                 /* result of each block; 0 = error */
+#if MMC_MULTITHREAD
+    pthread_mutex_t mutex;
+#endif
+} MMC_parseJob_t;
+
+/* block n writes its sequences from this slot; MMC_PARSEMT_BOUND() ensures blocks don't overlap */
+static MMC_sequence_t* MMC_blockSeqStart(const MMC_parseJob_t* job, size_t blockNb)
+{
+    return job->seqOut + (blockNb * job->blockSize) / MMC_MINMATCH_MIN + blockNb;
+}
+
+static void* MMC_parseWorker(void* arg)
+{
+    MMC_parseJob_t* const job = (MMC_parseJob_t*)arg;
+    MMC_ctx* const ctx = MMC_createAdvanced(job->params);
+    for (;;) {
+        size_t blockNb;
+#if MMC_MULTITHREAD
+        pthread_mutex_lock(&job->mutex);
+#endif
+        blockNb = job->nextBlock++;
+#if MMC_MULTITHREAD
+        pthread_mutex_unlock(&job->mutex);
+#endif
+        if (blockNb >= job->nbBlocks) break;
+        job->nbSeqs[blockNb] = 0;
+        if (ctx == NULL) continue;
+        {   size_t const blockPos = blockNb * job->blockSize;
+            const BYTE* const blockStart = job->src + blockPos;
+            size_t const blockSize = MIN(job->blockSize, job->srcSize - blockPos);
+            const BYTE* const prefixStart = blockStart - MIN(blockPos, ctx->maxDistance);
+            size_t const readSize = MMC_READSIZE(ctx->minMatch);
+            size_t const insertLimit = (job->srcSize > readSize) ? job->srcSize - readSize : 0;   /* insertion reads readSize bytes */
+            const BYTE* const insertEnd = job->src + MIN(blockPos, insertLimit);
+            /* pre-fill : the window preceding the block is inserted, not searched */
+            if (MMC_init(ctx, prefixStart)) continue;
+            if (MMC_continue(ctx, prefixStart, (size_t)(blockStart - prefixStart))) continue;
+            if ((prefixStart < insertEnd) && MMC_insertRange(ctx, prefixStart, insertEnd)) continue;
+            job->nbSeqs[blockNb] = MMC_parse(ctx, blockStart, blockSize, job->strategy, MMC_blockSeqStart(job, blockNb));
+    }   }
+    MMC_free(ctx);
+    return NULL;
+}
+
+size_t MMC_parseMT(const void* src, size_t srcSize, MMC_strategy strategy, MMC_parameters params,
+                   size_t blockSize, unsigned nbThreads, MMC_sequence_t* seqOut)
+{
+    MMC_parseJob_t job;
+    size_t nbSeqTotal = 0;
+    U32 const windowLog = params.windowLog ? params.windowLog : WINDOWLOG_DEFAULT;
+
+    if (windowLog > MMC_WINDOWLOG_MAX) return 0;
+    if (blockSize == 0) blockSize = MAX((size_t)1 << 20, (size_t)4 << windowLog);
+    if (blockSize < MMC_BLOCKSIZE_MIN) blockSize = MMC_BLOCKSIZE_MIN;
+    job.src = (const BYTE*)src;
+    job.srcSize = srcSize;
+    job.blockSize = blockSize;
+    job.nbBlocks = srcSize ? (srcSize + blockSize - 1) / blockSize : 1;
+    job.nextBlock = 0;
+    job.strategy = strategy;
+    job.params = params;
+    job.seqOut = seqOut;
+    job.nbSeqs = (size_t*)ALLOCATOR(job.nbBlocks * sizeof(size_t));
+    if (job.nbSeqs == NULL) return 0;
+
+#if MMC_MULTITHREAD
+    if (pthread_mutex_init(&job.mutex, NULL)) { FREEMEM(job.nbSeqs); return 0; }
+    {   unsigned const nbWorkers = (unsigned)MIN(MAX(nbThreads, 1), job.nbBlocks);
+        pthread_t* const threads = (pthread_t*)ALLOCATOR(nbWorkers * sizeof(pthread_t));
+        unsigned n, nbStarted = 0;
+        if (threads != NULL)
+            for (n=1; n<nbWorkers; n++) {   /* calling thread is worker 0 */
+                if (pthread_create(&threads[nbStarted], NULL, MMC_parseWorker, &job)) break;   /* remaining blocks are parsed by started workers */
+                nbStarted++;
+            }
+        MMC_parseWorker(&job);
+        for (n=0; n<nbStarted; n++) pthread_join(threads[n], NULL);
+        FREEMEM(threads);
+    }
+    pthread_mutex_destroy(&job.mutex);
+#else
+    (void)nbThreads;
+    MMC_parseWorker(&job);
+#endif
+
+    /* stitch blocks : trailing literals of a block are prepended to first sequence of next one */
+    {   size_t blockNb;
+        unsigned pendingLiterals = 0;
+        for (blockNb=0; blockNb<job.nbBlocks; blockNb++) {
+            MMC_sequence_t* const blockSeq = MMC_blockSeqStart(&job, blockNb);
+            size_t nbSeq = job.nbSeqs[blockNb];
+            if (nbSeq == 0) { nbSeqTotal = 0; break; }   /* error */
+            blockSeq[0].litLength += pendingLiterals;
+            if (blockNb < job.nbBlocks-1) {
+                nbSeq--;
+                pendingLiterals = blockSeq[nbSeq].litLength;
+            }
+            memmove(seqOut + nbSeqTotal, blockSeq, nbSeq * sizeof(*seqOut));
+            nbSeqTotal += nbSeq;
+    }   }
+
+    FREEMEM(job.nbSeqs);
+    return nbSeqTotal;
+}
+
+
+/* *******************************************************************
+*  Dictionary
+*********************************************************************/
+size_t MMC_loadDictionary(MMC_ctx* MMC, const void* dict, size_t dictSize)
+{
+    const BYTE* const dictStart = (const BYTE*)dict;
+    size_t const readSize = MMC_READSIZE(MMC->minMatch);
+    if (MMC_init(MMC, dict)) return 1;
+    if (MMC_continue(MMC, dict, dictSize)) return 1;
+    if (dictSize <= readSize) return 0;
+    /* MMC_insertRange() reads up to minMatch bytes beyond its end, and sequences are read readSize at a time */
+    return MMC_insertRange(MMC, dictStart, dictStart + dictSize - readSize);
+}
+
+size_t MMC_copyCtx(MMC_ctx* dst, const MMC_ctx* src)
+{
+    if ( (dst->windowLog != src->windowLog)
+      || (dst->hashLog != src->hashLog)
+      || (dst->minMatch != src->minMatch) ) return 1;   /* incompatible parameters */
+
+    memcpy(dst->chainTable, src->chainTable, MMC_tablesSize(src));
+    dst->beginBuffer = src->beginBuffer;
+    dst->nextSrc = src->nextSrc;
+    dst->base = src->base;
+    dst->dictBase = src->dictBase;
+    dst->dictLimit = src->dictLimit;
+    dst->lowLimit = src->lowLimit;
+    dst->workAvg = src->workAvg;
+    dst->shallow = src->shallow;
+    {   int c;
+        for (c=0; c<NBCHARACTERS; c++) {
+            segmentTracker_t* const dstTracker = dst->segments + c;
+            const segmentTracker_t* const srcTracker = src->segments + c;
+            memcpy(dstTracker->segments, srcTracker->segments, (srcTracker->start+1) * sizeof(segmentInfo_t));
+            dstTracker->start = srcTracker->start;
+    }   }
+    return 0;
+}
+
+
+/* **********************************************************
+*  Statistics
+************************************************************/
+size_t MMC_getStats(const MMC_ctx* ctx, MMC_stats_t* stats)
+{
+#if MMC_STATS
+    *stats = ctx->stats;
+    return 0;
+#else
+    (void)ctx;
+    MEM_INIT(stats, 0, sizeof(*stats));
+    return 1;   /* counters not compiled in */
+#endif
+}
@@ -49,14 +49,131 @@ void     MMC_free  (MMC_ctx* ctx);
 
 /**
 MMC_create : create an MMC object to search matches into a single continuous bufferSize
-             up to a distance of WindowSize (Note : WindowSize is a compile-time constant).
+             up to a distance of WindowSize (default : 64 KB, see MMC_createAdvanced()).
              @return : Pointer to MMC Data Structure; NULL = error
 MMC_init   : prepare MMC object to start searching from position beginBuffer;
+             previous content is forgotten. A context can be re-initialized any number of times :
+             with MMC_INDEX_MODE (default), this costs O(1), tables are not erased.
+             Positions are then stored as 32-bit indices : buffer size is not limited,
+             but indices are rebased every 3 GB of input, which costs one pass over all tables.
+             A single RLE run must remain shorter than 1 GB.
              @return : 0 on success, 1 on error.
 MMC_free   : free memory from MMC Data Structure;
              ctx must be NULL of valid.
 */
 
+
+/* **********************************************************
+*  Advanced parameters
+************************************************************/
+#define MMC_WINDOWLOG_MIN  10
+#define MMC_WINDOWLOG_MAX  26
+#define MMC_HASHLOG_MIN     8
+#define MMC_HASHLOG_MAX    24
+#define MMC_MINMATCH_MIN    3
+#define MMC_MINMATCH_MAX    8
+
+typedef struct {
+    unsigned windowLog;   /* search window size, as a power of 2; 0 = default (16 => 64 KB) */
+    unsigned hashLog;     /* nb of hash table entries, as a power of 2; 0 = default (windowLog-1, up to 22) */
+    unsigned minMatch;    /* minimum match length, from 3 to 8; 0 = default (4) */
+    unsigned maxAttempts; /* max nb of candidates examined per search; 0 = default (unlimited) */
+    unsigned niceLength;  /* search stops as soon as a match of this length is found; 0 = default (unlimited) */
+} MMC_parameters;
+
+MMC_ctx* MMC_createAdvanced(MMC_parameters params);
+
+typedef void* (*MMC_allocFunction) (void* opaque, size_t size);
+typedef void  (*MMC_freeFunction) (void* opaque, void* address);
+typedef struct { MMC_allocFunction customAlloc; MMC_freeFunction customFree; void* opaque; } MMC_customMem;
+
+MMC_ctx* MMC_createWithAllocator(MMC_parameters params, MMC_customMem customMem);
+
+/**
+MMC_createAdvanced :
+             same as MMC_create(), but window and hash table sizes are selected at runtime.
+             A field set to 0 uses its default value.
+             Each minMatch value has its own specialized search loop.
+             With minMatch >= 5, positions closer than 8 bytes from the end of input are not searched.
+             maxAttempts and niceLength bound the effort of each search, trading match length for speed.
+             A search stopped early leaves chains valid : later searches remain correct,
+             and can still find candidates which were not examined.
+             Memory usage (see MMC_estimateCtxSize()) is roughly
+             (2 << windowLog) + (1 << hashLog) + (1 << MIN(windowLog-1, 16)) positions,
+             plus 256 lists of about sqrt(2 << windowLog) RLE segments, of 2 positions each.
+             A position is 4 bytes (8 with raw pointers on 64-bit, see MMC_INDEX_MODE).
+             MMC_HASH_TAGS triples hash table, and MMC_LONG_HASH adds (1 << hashLog) positions.
+             Default parameters use about 1.5 MB.
+             Large windows (up to 64 MB) are supported, typically for long range redundancy.
+             @return : Pointer to MMC Data Structure; NULL = error (including invalid parameters)
+MMC_createWithAllocator :
+             same as MMC_createAdvanced(), but memory is provided by customMem.customAlloc(),
+             and released by customMem.customFree() within MMC_free().
+             Both functions must be set, or both NULL (default : stdlib's calloc() and free()).
+             The context is allocated once, in a single block :
+             afterwards, MMC_init(), searches and insertions never allocate.
+*/
+
+
+size_t   MMC_estimateCtxSize(MMC_parameters params);
+MMC_ctx* MMC_initStatic(void* workspace, size_t workspaceSize, MMC_parameters params);
+
+/**
+MMC_estimateCtxSize :
+             @return : size of workspace needed by MMC_initStatic() for these parameters; 0 = invalid parameters
+MMC_initStatic :
+             build a context within caller-provided memory, without any allocation.
+             Context and tables are aligned on cache lines within workspace, which needs no particular alignment.
+             workspace must remain valid while the context is in use,
+             and is not released by MMC_free() (which can still be called, and does nothing).
+             @return : Pointer to MMC Data Structure, within workspace;
+                       NULL = error (workspaceSize too small, or invalid parameters)
+*/
+
+
+/* ***********************************************************
+*  Streaming
+*************************************************************/
+size_t MMC_continue(MMC_ctx* ctx, const void* newBuffer, size_t size);
+
+/**
+MMC_continue :
+    make [newBuffer, newBuffer+size) the next part of the searched stream.
+    If newBuffer directly follows previous data, the window just extends over it.
+    Otherwise, previous buffer remains searchable as an external dictionary, without being copied :
+    it must remain valid and unmodified while newBuffer is being searched.
+    Only one previous buffer is kept : data from older buffers is no longer referenced.
+    Previous buffer is considered to end at the last byte provided (via MMC_continue() size)
+    or reached by a search (inputPointer + maxLength), whichever is furthest.
+    A stream typically starts with MMC_init(ctx, buf0) then MMC_continue(ctx, buf0, size0).
+    Matches found in previous buffer may continue into the beginning of current buffer,
+    as if both buffers were contiguous.
+    Requires MMC_INDEX_MODE (default) : with raw pointers, newBuffer must follow previous data.
+    size is limited to 3 GB.
+    @return : 0 on success, 1 on error
+*/
+
+
+/* ***********************************************************
+*  Dictionary
+*************************************************************/
+size_t MMC_loadDictionary(MMC_ctx* ctx, const void* dict, size_t dictSize);
+size_t MMC_copyCtx(MMC_ctx* dst, const MMC_ctx* src);
+
+/**
+MMC_loadDictionary :
+    reset ctx, and index the whole content of dict, which becomes searchable.
+    Then, use MMC_continue(ctx, src, srcSize) to start searching src.
+    dict must remain valid and unmodified while ctx references it.
+    @return : 0 on success, 1 on error
+MMC_copyCtx :
+    duplicate the state of src into dst, typically a context primed with MMC_loadDictionary(),
+    so that each new input starts from a ready index, for the cost of one memcpy().
+    Both contexts must have been created with same parameters.
+    @return : 0 on success, 1 on error
+*/
+
+
 /* ***********************************************************
 *  Search operations
 *************************************************************/
@@ -70,8 +187,155 @@ MMC_insertAndFindBestMatch :
     @return : length of Best Match
             if return == 0, no match was found
             if return > 0, match position is stored into *matchpos
+    Note : by default, a context guards against pathological inputs (see MMC_GUARD in mmc.c) :
+    when recent searches have examined too many candidates, following ones examine at most 16 candidates,
+    stop on the first match of 256 bytes, and don't measure matches beyond 4 KB,
+    whatever maxAttempts and niceLength. Matches remain valid, but may be shorter or farther.
+    Build with MMC_GUARD=0 to disable it.
+*/
+
+typedef struct {
+    unsigned length;
+    unsigned offset;   /* distance from inputPointer to match position */
+} MMC_match_t;
+
+size_t MMC_insertAndFindAllMatches (MMC_ctx* ctx, const void* inputPointer, size_t maxLength,
+                                    MMC_match_t* matches, size_t nbMatchesMax);
+
+/**
+MMC_insertAndFindAllMatches :
+    same as MMC_insertAndFindBestMatch(), but lists every improving candidate met during the search,
+    which is useful for optimal parsers.
+    Candidates are sorted by strictly increasing length;
+    each one is the closest position found reaching that length.
+    If there are more than nbMatchesMax candidates, the last slot keeps the longest one.
+    @return : nb of candidates stored into matches[] (0 if no match was found)
 */
 
+size_t MMC_findMatchesBatch (MMC_ctx* ctx, const void* src, size_t srcSize, unsigned* lengths, unsigned* offsets);
+
+/**
+MMC_findMatchesBatch :
+    insert and search every position of [src, src+srcSize), in order, with matches ending within src+srcSize.
+    Same results as calling MMC_insertAndFindBestMatch(ctx, src+n, srcSize-n, ...) for each position n.
+    It only saves, per position, the function call, the dispatch on minMatch and the match pointer :
+    each search still loads its state from ctx, so gains are modest, and mostly on short searches.
+    Results are stored as 2 separate arrays, of srcSize entries each :
+    lengths[n] is the length of the best match at position n, 0 if none,
+    offsets[n] its distance from position n (0 when there is no match).
+    @return : nb of positions with a match
+*/
+
+typedef struct {
+    MMC_ctx* ctx;
+    const void* src;
+    size_t srcSize;
+    unsigned* lengths;   /* srcSize entries */
+    unsigned* offsets;   /* srcSize entries */
+} MMC_stream_t;
+
+size_t MMC_findMatchesInterleaved (MMC_stream_t* streams, size_t nbStreams);
+
+/**
+MMC_findMatchesInterleaved :
+    same as MMC_findMatchesBatch(stream.ctx, stream.src, stream.srcSize, stream.lengths, stream.offsets)
+    for each of nbStreams independent streams, each with its own context,
+    but streams advance together, one position at a time.
+    Memory accesses starting the searches of all streams are requested before any search begins,
+    so that cache misses of different streams overlap, instead of stalling one after another.
+    Tables of all contexts compete for cache though : a few streams (4-8) at a time is usually best,
+    and contexts small enough to stay in cache are faster searched one after another.
+    Contexts must be distinct. Results are identical to separate MMC_findMatchesBatch() calls.
+    @return : total nb of positions with a match
+*/
+
+
+size_t MMC_insertRange (MMC_ctx* ctx, const void* from, const void* to);
+
+/**
+MMC_insertRange :
+    insert positions from `from` up to `to` (excluded) into ctx, without searching them.
+    Typically used on positions covered by a match emitted by the parser,
+    since searching them would be wasted effort.
+    Runs of identical bytes are skipped over in a single step.
+    Each inserted position reads its first minMatch bytes (8 bytes when minMatch > 4),
+    so `to` must stop that many bytes before the end of input.
+    @return : 0 (insertion can't fail)
+*/
+
+
+/* ***********************************************************
+*  Parsing
+*************************************************************/
+typedef enum { MMC_greedy=1, MMC_lazy=2, MMC_lazy2=3 } MMC_strategy;
+
+typedef struct {
+    unsigned litLength;     /* nb of literals preceding the match */
+    unsigned matchLength;   /* 0 for the last sequence, which only holds trailing literals */
+    unsigned offset;        /* distance from match start to its reference */
+} MMC_sequence_t;
+
+#define MMC_PARSE_BOUND(srcSize)  ((srcSize) / MMC_MINMATCH_MIN + 1)   /* max nb of sequences produced by MMC_parse() */
+
+size_t MMC_parse(MMC_ctx* ctx, const void* src, size_t srcSize, MMC_strategy strategy, MMC_sequence_t* seqOut);
+
+/**
+MMC_parse :
+    cut src into a list of sequences (literals followed by a match), ending with a literals-only sequence.
+    src is appended to the searched stream, exactly as with MMC_continue(ctx, src, srcSize) :
+    previous data (from MMC_init(), MMC_loadDictionary() or a previous MMC_parse()) can be referenced.
+    @strategy : MMC_greedy : take the match found at current position.
+                MMC_lazy   : also search next position, and take its match instead if it looks better.
+                MMC_lazy2  : same as MMC_lazy, looking up to 2 positions ahead.
+    Matches are extended backwards over pending literals.
+    Positions covered by a match are inserted, but not searched.
+    @seqOut : must be large enough to hold MMC_PARSE_BOUND(srcSize) sequences
+    @return : nb of sequences written into seqOut (at least 1), or 0 on error
+*/
+
+#define MMC_BLOCKSIZE_MIN  (64 << 10)
+#define MMC_PARSEMT_BOUND(srcSize)  (MMC_PARSE_BOUND(srcSize) + (srcSize) / MMC_BLOCKSIZE_MIN + 1)   /* max nb of sequences produced by MMC_parseMT() */
+
+size_t MMC_parseMT(const void* src, size_t srcSize, MMC_strategy strategy, MMC_parameters params,
+                   size_t blockSize, unsigned nbThreads, MMC_sequence_t* seqOut);
+
+/**
+MMC_parseMT :
+    same result format as MMC_parse(), for a single large input parsed by nbThreads worker threads.
+    src is cut into blocks of blockSize bytes (0 = default : max(1 MB, 4 x window), minimum MMC_BLOCKSIZE_MIN).
+    Each worker owns a context created with params. Before parsing a block,
+    it inserts the preceding window of data without searching it, so matches can cross block boundaries.
+    Sequences of all blocks are then stitched in order into seqOut.
+    Matches don't extend beyond the end of their block, so results differ slightly from MMC_parse().
+    Threads require MMC_MULTITHREAD=1 at compilation (and linking with -pthread) :
+    otherwise blocks are parsed one after another, with identical results.
+    @seqOut : must be large enough to hold MMC_PARSEMT_BOUND(srcSize) sequences
+    @return : nb of sequences written into seqOut, or 0 on error
+*/
+
+/* ***********************************************************
+*  Statistics
+*************************************************************/
+typedef struct {
+    size_t hashLookups;       /* searches which looked up the hash table */
+    size_t chainHops;         /* candidates examined, at all levels */
+    size_t collisions;        /* base level candidates skipped, because their first minMatch bytes differ */
+    size_t promotions;        /* candidates moved up to a higher level */
+    size_t levelDowns;        /* returns to a lower level, at the end of an incomplete level (LEVEL_DOWN) */
+    size_t rleHits;           /* searches handled by the RLE match finder */
+    size_t segmentOverflows;  /* RLE segment lists found full, and compacted */
+    size_t maxLevel;          /* highest level reached */
+    size_t longHashHits;      /* searches starting from a long candidate (only with MMC_LONG_HASH) */
+} MMC_stats_t;
+
+size_t MMC_getStats(const MMC_ctx* ctx, MMC_stats_t* stats);
+
+/**
+MMC_getStats :
+    copy into *stats the counters accumulated by ctx since last MMC_init().
+    Counters exist only when mmc.c is compiled with MMC_STATS=1 (disabled by default, for speed).
+    @return : 0 on success, 1 if counters are not compiled in (*stats is then zeroed)
+*/
 
 #if defined (__cplusplus)
 }
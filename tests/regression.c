@@ -0,0 +1,509 @@
+/*  regression tests for mmc.c
+    Copyright (C) Yann Collet 2018-present
+
+    GPL v2 License
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    You can contact the author at :
+    - public issue list : https://github.com/Cyan4973/mmc/issues
+    - website : http://fastcompression.blogspot.com/
+*/
+
+#include <stdlib.h>  /* malloc, free, exit */
+#include <stdio.h>   /* printf */
+#include <string.h>  /* memcpy, memcmp, memset */
+
+#include "mmc.h"
+
+/* same default as mmc.c : with raw pointers (MMC_INDEX_MODE=0), buffers can't be non-contiguous */
+#ifndef MMC_INDEX_MODE
+#  define MMC_INDEX_MODE 1
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/mman.h>   /* mmap, mprotect, munmap */
+#  include <unistd.h>     /* sysconf */
+#  define GUARD_PAGE 1
+#else
+#  define GUARD_PAGE 0
+#endif
+
+
+/* --- guarded buffers --- */
+/* when possible, a buffer ends right before an inaccessible page :
+ * reading beyond its end crashes, instead of going unnoticed */
+typedef struct {
+    unsigned char* start;
+    void* alloc;
+    size_t allocSize;
+} guardedBuffer_t;
+
+static guardedBuffer_t GB_create(const void* content, size_t size)
+{
+    guardedBuffer_t gb;
+#if GUARD_PAGE
+    size_t const pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t const dataSize = (size + pageSize-1) / pageSize * pageSize;
+    gb.allocSize = dataSize + pageSize;
+    gb.alloc = mmap(NULL, gb.allocSize, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (gb.alloc == MAP_FAILED) { printf("mmap failed \n"); exit(1); }
+    if (mprotect((char*)gb.alloc + dataSize, pageSize, PROT_NONE)) { printf("mprotect failed \n"); exit(1); }
+    gb.start = (unsigned char*)gb.alloc + dataSize - size;
+#else
+    gb.allocSize = size;
+    gb.alloc = malloc(size ? size : 1);
+    if (gb.alloc == NULL) { printf("malloc failed \n"); exit(1); }
+    gb.start = (unsigned char*)gb.alloc;
+#endif
+    memcpy(gb.start, content, size);
+    return gb;
+}
+
+static void GB_free(guardedBuffer_t gb)
+{
+#if GUARD_PAGE
+    munmap(gb.alloc, gb.allocSize);
+#else
+    free(gb.alloc);
+#endif
+}
+
+
+/* --- tests --- */
+#define CHECK(c, msg) { if (!(c)) { printf("%s \n", msg); return 1; } }
+
+/* fills buf with words drawn from a small vocabulary : many repetitions, at all distances */
+static void fillText(unsigned char* buf, size_t size, unsigned seed)
+{
+    static const char* const words[] = { "the ", "match ", "finder ", "chain ", "level ", "morphing ",
+                                         "of ", "and ", "search ", "window ", "data\n", "0123456789 " };
+    size_t pos = 0;
+    while (pos < size) {
+        const char* w;
+        seed = seed * 1103515245 + 12345;
+        w = words[(seed >> 16) % (sizeof(words)/sizeof(words[0]))];
+        while (*w && pos < size) buf[pos++] = (unsigned char)*w++;
+    }
+}
+
+/* rebuilds src from sequences : literals are copied from src, matches from already decoded data,
+ * which starts with history (data preceding src, which matches can reference).
+ * @return : 1 if sequences are well formed, and decode exactly into src */
+static int sequencesDecode(const MMC_sequence_t* seqs, size_t nbSeqs,
+                           const unsigned char* history, size_t historySize,
+                           const unsigned char* src, size_t srcSize)
+{
+    unsigned char* const out = (unsigned char*)malloc(historySize + srcSize + 1);
+    size_t op = historySize, ip = 0, n;
+    int ok = (out != NULL) && (nbSeqs > 0);
+    if (ok && historySize) memcpy(out, history, historySize);
+    for (n=0; ok && n<nbSeqs; n++) {
+        MMC_sequence_t const seq = seqs[n];
+        if ((seq.litLength > srcSize - ip) || ((seq.matchLength == 0) != (n == nbSeqs-1))) { ok = 0; break; }
+        memcpy(out + op, src + ip, seq.litLength);
+        op += seq.litLength; ip += seq.litLength;
+        if ((seq.matchLength > srcSize - ip) || (seq.matchLength && (seq.offset == 0 || seq.offset > op))) { ok = 0; break; }
+        {   unsigned u;
+            for (u=0; u<seq.matchLength; u++) { out[op] = out[op - seq.offset]; op++; }   /* byte per byte : source may overlap */
+        }
+        ip += seq.matchLength;
+    }
+    ok = ok && (ip == srcSize) && !memcmp(out + historySize, src, srcSize);
+    free(out);
+    return ok;
+}
+
+/* searches every position of buf, with maxLength capped to lengthMax (0 = no cap),
+ * and checks that every match found is genuine.
+ * @return : nb of invalid matches */
+static size_t countInvalidMatches(const unsigned char* buf, size_t size, MMC_parameters params, size_t lengthMax)
+{
+    MMC_ctx* const ctx = MMC_createAdvanced(params);
+    size_t pos, nbInvalid = 0;
+    if (ctx == NULL) return 1;
+    MMC_init(ctx, buf);
+    for (pos=0; pos<size; pos++) {
+        const void* match;
+        size_t const maxLength = (lengthMax && (size - pos > lengthMax)) ? lengthMax : size - pos;
+        size_t const length = MMC_insertAndFindBestMatch(ctx, buf + pos, maxLength, &match);
+        if (length > maxLength || (length && memcmp(match, buf + pos, length))) nbInvalid++;
+    }
+    MMC_free(ctx);
+    return nbInvalid;
+}
+
+/* RLE forward scan, on a run reaching the end of input */
+static int test_rleRunAtEnd(void)
+{
+    static const char content[] = "bcdAAAAAAAA";
+    size_t const size = sizeof(content) - 1;
+    guardedBuffer_t const gb = GB_create(content, size);
+    MMC_ctx* const ctx = MMC_create();
+    const void* match;
+    size_t length;
+    CHECK(ctx != NULL, "rleRunAtEnd : MMC_create() failed");
+    MMC_init(ctx, gb.start);
+    length = MMC_insertAndFindBestMatch(ctx, gb.start + 3, size - 3, &match);
+    CHECK(length <= size - 3, "rleRunAtEnd : match beyond end of input");
+    MMC_free(ctx);
+    GB_free(gb);
+    return 0;
+}
+
+/* a run of exactly minMatch bytes ending the input, searched at every position */
+static int test_shortRunAtEnd(void)
+{
+    static const char content[] = "abcAAAAdefAAAA";
+    size_t const size = sizeof(content) - 1;
+    guardedBuffer_t const gb = GB_create(content, size);
+    MMC_ctx* const ctx = MMC_create();
+    size_t pos;
+    CHECK(ctx != NULL, "shortRunAtEnd : MMC_create() failed");
+    MMC_init(ctx, gb.start);
+    for (pos=0; pos<size; pos++) {
+        const void* match;
+        size_t const length = MMC_insertAndFindBestMatch(ctx, gb.start + pos, size - pos, &match);
+        CHECK(length <= size - pos, "shortRunAtEnd : match beyond end of input");
+    }
+    MMC_free(ctx);
+    GB_free(gb);
+    return 0;
+}
+
+/* many decreasing runs of a same byte, interleaved with noise :
+ * RLE segment lists fill up while most of them are still within window.
+ * maxAttempts makes the search trust segment positions without re-checking them.
+ * Searches stopped by maxAttempts or niceLength must also leave chains valid, whatever minMatch. */
+static int test_decreasingRuns(void)
+{
+    size_t const size = 400 << 10;
+    unsigned char* const buf = (unsigned char*)malloc(size);
+    MMC_parameters params;
+    MMC_ctx* ctx;
+    unsigned seed = 1;
+    unsigned runLength = 300;
+    static const unsigned limits[][2] = { { 5, 0 }, { 3, 0 }, { 0, 16 } };   /* maxAttempts, niceLength */
+    size_t pos = 0, l;
+    unsigned wlog;
+    CHECK(buf != NULL, "decreasingRuns : malloc failed");
+    while (pos < size) {
+        seed = seed * 1103515245 + 12345;
+        if (((seed >> 16) % 30) == 0) {
+            unsigned u;
+            for (u=0; u<runLength && pos<size; u++) buf[pos++] = 'C';
+            if (--runLength < 4) runLength = 300;
+        } else {
+            buf[pos++] = "ABC"[(seed >> 16) % 3];
+    }   }
+
+    memset(&params, 0, sizeof(params));
+    params.maxAttempts = 5;
+    ctx = MMC_createAdvanced(params);
+    CHECK(ctx != NULL, "decreasingRuns : MMC_createAdvanced() failed");
+    MMC_init(ctx, buf);
+    for (pos=0; pos<size; pos++) {
+        MMC_match_t matches[16];
+        size_t const nbMatches = MMC_insertAndFindAllMatches(ctx, buf + pos, size - pos, matches, 16);
+        size_t n;
+        for (n=0; n<nbMatches; n++)
+            CHECK(!memcmp(buf + pos - matches[n].offset, buf + pos, matches[n].length), "decreasingRuns : invalid match");
+    }
+
+    /* searches stopped early, by either limit, for every minMatch */
+    for (l=0; l<sizeof(limits)/sizeof(limits[0]); l++) {
+        for (wlog=10; wlog<=16; wlog+=6) {
+            memset(&params, 0, sizeof(params));
+            params.windowLog = wlog;
+            params.maxAttempts = limits[l][0];
+            params.niceLength = limits[l][1];
+            for (params.minMatch=3; params.minMatch<=8; params.minMatch++)
+                CHECK(countInvalidMatches(buf, size, params, 0) == 0, "decreasingRuns : invalid best match");
+    }   }
+
+    MMC_free(ctx);
+    free(buf);
+    return 0;
+}
+
+/* MMC_continue() rejecting a buffer too large must leave context usable,
+ * including when indexes would have been reduced */
+static int test_continueTooLarge(void)
+{
+    size_t const size = 4096;
+    unsigned char* const buf = (unsigned char*)malloc(size);
+    static const char other[] = "other buffer";
+    MMC_parameters params;
+    MMC_ctx* ctx;
+    const void* match = NULL;
+    unsigned seed = 1;
+    size_t pos, length;
+    CHECK(buf != NULL, "continueTooLarge : malloc failed");
+    for (pos=0; pos<size; pos++) { seed = seed * 1103515245 + 12345; buf[pos] = (unsigned char)(seed >> 16); }
+    memcpy(buf + 3500, buf + 3000, 64);
+
+    memset(&params, 0, sizeof(params));
+    params.windowLog = 10;
+    ctx = MMC_createAdvanced(params);
+    CHECK(ctx != NULL, "continueTooLarge : MMC_createAdvanced() failed");
+    MMC_init(ctx, buf);
+    for (pos=0; pos<3500; pos++) (void)MMC_insertAndFindBestMatch(ctx, buf + pos, 3500 - pos, &match);
+    CHECK(MMC_continue(ctx, other, (size_t)-1) == 1, "continueTooLarge : buffer too large was accepted");
+    length = MMC_insertAndFindBestMatch(ctx, buf + 3500, 64, &match);
+    CHECK(length == 64 && match == buf + 3000, "continueTooLarge : context modified by failed MMC_continue()");
+
+    MMC_free(ctx);
+    free(buf);
+    return 0;
+}
+/* maxLength capped below the longest available match, as bounded-length formats do */
+static int test_cappedLength(void)
+{
+    size_t const size = 200 << 10;
+    unsigned char* const buf = (unsigned char*)malloc(size);
+    MMC_parameters params;
+    unsigned seed = 1;
+    size_t pos;
+    CHECK(buf != NULL, "cappedLength : malloc failed");
+    for (pos=0; pos<size; pos++) { seed = seed * 1103515245 + 12345; buf[pos] = "abcd"[(seed >> 16) & 3]; }
+
+    memset(&params, 0, sizeof(params));
+    params.windowLog = 16;
+    for (params.minMatch=3; params.minMatch<=8; params.minMatch++)
+        CHECK(countInvalidMatches(buf, size, params, 12) == 0, "cappedLength : invalid match");
+
+    free(buf);
+    return 0;
+}
+
+/* MMC_parse() sequences decode back into input, for all strategies,
+ * including a second, non-contiguous chunk referencing the first one */
+static int test_parse(void)
+{
+    size_t const size1 = 200 << 10, size2 = 50 << 10;
+    unsigned char* const chunk1 = (unsigned char*)malloc(size1);
+    unsigned char* const chunk2 = (unsigned char*)malloc(size2);
+    MMC_sequence_t* const seqs = (MMC_sequence_t*)malloc(MMC_PARSE_BOUND(size1) * sizeof(MMC_sequence_t));
+    MMC_ctx* const ctx = MMC_create();
+    int strategy;
+    CHECK(chunk1 != NULL && chunk2 != NULL && seqs != NULL && ctx != NULL, "parse : allocation failed");
+    fillText(chunk1, size1, 1);
+    memcpy(chunk2, chunk1 + size1 - 1000, 1000);   /* only found within previous chunk */
+    fillText(chunk2 + 1000, size2 - 1000, 2);
+
+    for (strategy=MMC_greedy; strategy<=MMC_lazy2; strategy++) {
+        size_t nbSeqs;
+        MMC_init(ctx, chunk1);
+        nbSeqs = MMC_parse(ctx, chunk1, size1, (MMC_strategy)strategy, seqs);
+        CHECK(sequencesDecode(seqs, nbSeqs, NULL, 0, chunk1, size1), "parse : sequences don't decode into input");
+        CHECK(nbSeqs > 1000, "parse : too few matches");
+#if MMC_INDEX_MODE
+        nbSeqs = MMC_parse(ctx, chunk2, size2, (MMC_strategy)strategy, seqs);
+        CHECK(sequencesDecode(seqs, nbSeqs, chunk1, size1, chunk2, size2), "parse : sequences don't decode into second chunk");
+        CHECK(seqs[0].matchLength >= 100 && seqs[0].offset > seqs[0].litLength, "parse : previous chunk not referenced");
+#endif
+    }
+
+    MMC_free(ctx);
+    free(seqs);
+    free(chunk2);
+    free(chunk1);
+    return 0;
+}
+
+/* MMC_parseMT() sequences decode back into input, for all strategies,
+ * including inputs shorter than a read, a last block shorter than a read,
+ * and literals ending a block */
+static int test_parseMT(void)
+{
+    static const size_t sizes[] = { 2, 3 * MMC_BLOCKSIZE_MIN + 3, 300 << 10 };
+    size_t const sizeMax = 300 << 10;
+    unsigned char* const content = (unsigned char*)malloc(sizeMax);
+    MMC_sequence_t* const seqs = (MMC_sequence_t*)malloc(MMC_PARSEMT_BOUND(sizeMax) * sizeof(MMC_sequence_t));
+    MMC_parameters params;
+    size_t n;
+    CHECK(content != NULL && seqs != NULL, "parseMT : allocation failed");
+    fillText(content, sizeMax, 3);
+    for (n=1; n*MMC_BLOCKSIZE_MIN < sizeMax; n++) {   /* unique bytes end each block with literals, carried into next block */
+        unsigned u;
+        for (u=0; u<8; u++) content[n*MMC_BLOCKSIZE_MIN - 8 + u] = (unsigned char)(0x80 + 8*n + u);
+    }
+    memset(&params, 0, sizeof(params));
+
+    for (n=0; n<sizeof(sizes)/sizeof(sizes[0]); n++) {
+        guardedBuffer_t const gb = GB_create(content, sizes[n]);
+        int strategy;
+        for (strategy=MMC_greedy; strategy<=MMC_lazy2; strategy++) {
+            size_t const nbSeqs = MMC_parseMT(gb.start, sizes[n], (MMC_strategy)strategy, params, MMC_BLOCKSIZE_MIN, 4, seqs);
+            CHECK(sequencesDecode(seqs, nbSeqs, NULL, 0, gb.start, sizes[n]), "parseMT : sequences don't decode into input");
+        }
+        GB_free(gb);
+    }
+
+    free(seqs);
+    free(content);
+    return 0;
+}
+
+/* a context primed with MMC_loadDictionary(), then duplicated with MMC_copyCtx(),
+ * parses the same as the original one, including when copied over a used context */
+static int test_dictionary(void)
+{
+    size_t const dictSize = 64 << 10, srcSize = 100 << 10;
+    unsigned char* const buf = (unsigned char*)malloc(dictSize + srcSize);   /* dictionary, immediately followed by src */
+    unsigned char* const src = buf + dictSize;
+    MMC_sequence_t* const seqs = (MMC_sequence_t*)malloc(MMC_PARSE_BOUND(srcSize) * sizeof(MMC_sequence_t));
+    MMC_sequence_t* const seqsCopy = (MMC_sequence_t*)malloc(MMC_PARSE_BOUND(srcSize) * sizeof(MMC_sequence_t));
+    MMC_ctx* const dictCtx = MMC_create();
+    MMC_ctx* const ctx = MMC_create();
+    MMC_parameters params;
+    MMC_ctx* otherCtx;
+    size_t nbSeqs, nbSeqsCopy;
+    CHECK(buf != NULL && seqs != NULL && seqsCopy != NULL && dictCtx != NULL && ctx != NULL, "dictionary : allocation failed");
+    fillText(buf, dictSize, 3);
+    fillText(src, srcSize, 4);
+    memcpy(src, buf + 1000, 5000);   /* only found within dictionary */
+    memset(buf + 30000, '=', 300);   /* runs exercise RLE segments */
+    memset(src + 20000, '=', 200);
+
+    CHECK(MMC_loadDictionary(dictCtx, buf, dictSize) == 0, "dictionary : MMC_loadDictionary() failed");
+    CHECK(MMC_copyCtx(ctx, dictCtx) == 0, "dictionary : MMC_copyCtx() failed");
+    nbSeqsCopy = MMC_parse(ctx, src, srcSize, MMC_greedy, seqsCopy);
+    CHECK(sequencesDecode(seqsCopy, nbSeqsCopy, buf, dictSize, src, srcSize), "dictionary : sequences don't decode into input");
+    CHECK(seqsCopy[0].matchLength >= 5000 && seqsCopy[0].offset == dictSize - 1000, "dictionary : not referenced");
+
+    /* copied again, over a used context */
+    CHECK(MMC_copyCtx(ctx, dictCtx) == 0, "dictionary : MMC_copyCtx() failed");
+    nbSeqs = MMC_parse(ctx, src, srcSize, MMC_greedy, seqs);
+    CHECK(nbSeqs == nbSeqsCopy && !memcmp(seqs, seqsCopy, nbSeqs * sizeof(*seqs)), "dictionary : second copy parses differently");
+
+    /* original context */
+    nbSeqs = MMC_parse(dictCtx, src, srcSize, MMC_greedy, seqs);
+    CHECK(nbSeqs == nbSeqsCopy && !memcmp(seqs, seqsCopy, nbSeqs * sizeof(*seqs)), "dictionary : copy parses differently");
+
+    memset(&params, 0, sizeof(params));
+    params.minMatch = 5;
+    otherCtx = MMC_createAdvanced(params);
+    CHECK(otherCtx != NULL, "dictionary : MMC_createAdvanced() failed");
+    CHECK(MMC_copyCtx(otherCtx, dictCtx) == 1, "dictionary : copy between incompatible contexts accepted");
+
+    MMC_free(otherCtx);
+    MMC_free(ctx);
+    MMC_free(dictCtx);
+    free(seqsCopy);
+    free(seqs);
+    free(buf);
+    return 0;
+}
+
+/* MMC_findMatchesBatch() gives the same results as MMC_insertAndFindBestMatch() at each position */
+static int test_batch(void)
+{
+    size_t const size = 100 << 10;
+    unsigned char* const buf = (unsigned char*)malloc(size);
+    unsigned* const lengths = (unsigned*)malloc(size * sizeof(unsigned));
+    unsigned* const offsets = (unsigned*)malloc(size * sizeof(unsigned));
+    MMC_parameters params;
+    CHECK(buf != NULL && lengths != NULL && offsets != NULL, "batch : allocation failed");
+    fillText(buf, size, 5);
+    memset(buf + 50000, 'z', 500);
+
+    memset(&params, 0, sizeof(params));
+    for (params.minMatch=3; params.minMatch<=8; params.minMatch++) {
+        MMC_ctx* const batchCtx = MMC_createAdvanced(params);
+        MMC_ctx* const ctx = MMC_createAdvanced(params);
+        size_t pos, nbFound = 0, nbFoundBatch;
+        CHECK(batchCtx != NULL && ctx != NULL, "batch : MMC_createAdvanced() failed");
+        MMC_init(batchCtx, buf);
+        MMC_init(ctx, buf);
+        nbFoundBatch = MMC_findMatchesBatch(batchCtx, buf, size, lengths, offsets);
+        for (pos=0; pos<size; pos++) {
+            const void* match;
+            size_t const length = MMC_insertAndFindBestMatch(ctx, buf + pos, size - pos, &match);
+            CHECK(lengths[pos] == length, "batch : different length");
+            CHECK(offsets[pos] == (length ? (size_t)(buf + pos - (const unsigned char*)match) : 0), "batch : different offset");
+            nbFound += (length > 0);
+        }
+        CHECK(nbFoundBatch == nbFound && nbFound > size / 2, "batch : wrong nb of matches");
+        MMC_free(ctx);
+        MMC_free(batchCtx);
+    }
+
+    free(offsets);
+    free(lengths);
+    free(buf);
+    return 0;
+}
+
+/* MMC_findMatchesInterleaved() gives the same results as MMC_findMatchesBatch() on each stream,
+ * with streams of different sizes and parameters */
+#define NB_STREAMS 5
+static int test_interleaved(void)
+{
+    size_t const sizeMax = 40 << 10;
+    unsigned char* const buf = (unsigned char*)malloc(NB_STREAMS * sizeMax);
+    unsigned* const results = (unsigned*)malloc(4 * NB_STREAMS * sizeMax * sizeof(unsigned));
+    MMC_stream_t streams[NB_STREAMS];
+    MMC_ctx* batchCtxs[NB_STREAMS];
+    size_t nbFound = 0, nbFoundInterleaved;
+    int s;
+    CHECK(buf != NULL && results != NULL, "interleaved : allocation failed");
+    fillText(buf, NB_STREAMS * sizeMax, 6);
+    for (s=0; s<NB_STREAMS; s++) {
+        MMC_parameters params;
+        memset(&params, 0, sizeof(params));
+        params.minMatch = 3 + s;
+        streams[s].ctx = MMC_createAdvanced(params);
+        batchCtxs[s] = MMC_createAdvanced(params);
+        CHECK(streams[s].ctx != NULL && batchCtxs[s] != NULL, "interleaved : MMC_createAdvanced() failed");
+        streams[s].src = buf + s * sizeMax;
+        streams[s].srcSize = sizeMax - s * 5000;
+        streams[s].lengths = results + (4*s) * sizeMax;
+        streams[s].offsets = results + (4*s+1) * sizeMax;
+        MMC_init(streams[s].ctx, streams[s].src);
+        MMC_init(batchCtxs[s], streams[s].src);
+    }
+
+    nbFoundInterleaved = MMC_findMatchesInterleaved(streams, NB_STREAMS);
+    for (s=0; s<NB_STREAMS; s++) {
+        unsigned* const lengths = results + (4*s+2) * sizeMax;
+        unsigned* const offsets = results + (4*s+3) * sizeMax;
+        nbFound += MMC_findMatchesBatch(batchCtxs[s], streams[s].src, streams[s].srcSize, lengths, offsets);
+        CHECK(!memcmp(lengths, streams[s].lengths, streams[s].srcSize * sizeof(unsigned)), "interleaved : different lengths");
+        CHECK(!memcmp(offsets, streams[s].offsets, streams[s].srcSize * sizeof(unsigned)), "interleaved : different offsets");
+        MMC_free(batchCtxs[s]);
+        MMC_free(streams[s].ctx);
+    }
+    CHECK(nbFoundInterleaved == nbFound, "interleaved : wrong nb of matches");
+
+    free(results);
+    free(buf);
+    return 0;
+}
+
+
+int main(void)
+{
+    int nbErrors = 0;
+    nbErrors += test_rleRunAtEnd();
+    nbErrors += test_shortRunAtEnd();
+    nbErrors += test_decreasingRuns();
+    nbErrors += test_continueTooLarge();
+    nbErrors += test_cappedLength();
+    nbErrors += test_parse();
+    nbErrors += test_parseMT();
+    nbErrors += test_dictionary();
+    nbErrors += test_batch();
+    nbErrors += test_interleaved();
+    if (nbErrors) { printf("%i test(s) failed \n", nbErrors); return 1; }
+    printf("all tests passed \n");
+    return 0;
+}